@@ -0,0 +1,583 @@
+/*---------------------------------------------------*/
+/* Program: Benchmark.cpp                            */
+/* Description: Benchmark of the engine library:     */
+/* times the game loop, the generic match path and   */
+/* the specialised kernels for every strategy        */
+/* pairing and writes the results as JSON and/or CSV.*/
+/*---------------------------------------------------*/
+
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+#include "PrisonersDilemma.h"
+
+using namespace std;
+using namespace ipd;
+
+//Heap allocations since start, counted by the replaced global allocation functions. Every form
+//of operator new (array, aligned and nothrow) is replaced together with its operator delete, so
+//all of them are counted and every block is released by the function that matches its allocation.
+static atomic<long long> allocationCount(0);
+
+//Allocate a counted block, aligned to more than the default when alignment is nonzero; nullptr on failure
+static void* countedAllocate(size_t size, size_t alignment = 0)
+{
+	allocationCount.fetch_add(1, memory_order_relaxed);
+	size = size ? size : 1;
+
+	if (alignment == 0)
+	{
+		return malloc(size);
+	}
+
+#ifdef _WIN32
+	return _aligned_malloc(size, alignment);
+#else
+	void* block = nullptr;
+	return (posix_memalign(&block, max(alignment, sizeof(void*)), size) == 0) ? block : nullptr;
+#endif
+}
+
+//Release a block from countedAllocate
+static void countedRelease(void* block, bool aligned = false)
+{
+#ifdef _WIN32
+	if (aligned)
+	{
+		_aligned_free(block);
+		return;
+	}
+#else
+	(void)aligned;
+#endif
+
+	free(block);
+}
+
+//Allocate for a throwing operator new
+static void* countedAllocateOrThrow(size_t size, size_t alignment = 0)
+{
+	if (void* block = countedAllocate(size, alignment))
+	{
+		return block;
+	}
+
+	throw bad_alloc();
+}
+
+void* operator new(size_t size)
+{
+	return countedAllocateOrThrow(size);
+}
+
+void* operator new[](size_t size)
+{
+	return countedAllocateOrThrow(size);
+}
+
+void* operator new(size_t size, const nothrow_t&) noexcept
+{
+	return countedAllocate(size);
+}
+
+void* operator new[](size_t size, const nothrow_t&) noexcept
+{
+	return countedAllocate(size);
+}
+
+void* operator new(size_t size, align_val_t alignment)
+{
+	return countedAllocateOrThrow(size, (size_t)alignment);
+}
+
+void* operator new[](size_t size, align_val_t alignment)
+{
+	return countedAllocateOrThrow(size, (size_t)alignment);
+}
+
+void* operator new(size_t size, align_val_t alignment, const nothrow_t&) noexcept
+{
+	return countedAllocate(size, (size_t)alignment);
+}
+
+void* operator new[](size_t size, align_val_t alignment, const nothrow_t&) noexcept
+{
+	return countedAllocate(size, (size_t)alignment);
+}
+
+void operator delete(void* block) noexcept
+{
+	countedRelease(block);
+}
+
+void operator delete[](void* block) noexcept
+{
+	countedRelease(block);
+}
+
+void operator delete(void* block, size_t) noexcept
+{
+	countedRelease(block);
+}
+
+void operator delete[](void* block, size_t) noexcept
+{
+	countedRelease(block);
+}
+
+void operator delete(void* block, const nothrow_t&) noexcept
+{
+	countedRelease(block);
+}
+
+void operator delete[](void* block, const nothrow_t&) noexcept
+{
+	countedRelease(block);
+}
+
+void operator delete(void* block, align_val_t) noexcept
+{
+	countedRelease(block, true);
+}
+
+void operator delete[](void* block, align_val_t) noexcept
+{
+	countedRelease(block, true);
+}
+
+void operator delete(void* block, size_t, align_val_t) noexcept
+{
+	countedRelease(block, true);
+}
+
+void operator delete[](void* block, size_t, align_val_t) noexcept
+{
+	countedRelease(block, true);
+}
+
+void operator delete(void* block, align_val_t, const nothrow_t&) noexcept
+{
+	countedRelease(block, true);
+}
+
+void operator delete[](void* block, align_val_t, const nothrow_t&) noexcept
+{
+	countedRelease(block, true);
+}
+
+
+//Stream buffer that discards everything, standing in for the console when output is not shown
+class NullBuffer : public streambuf
+{
+protected:
+	int overflow(int c) override
+	{
+		return c;
+	}
+
+	streamsize xsputn(const char*, streamsize count) override
+	{
+		return count;
+	}
+};
+
+
+//One measured case
+struct BenchResult
+{
+	string engine;
+	string pairing;
+	int players = 2;
+	long long rounds = 0;
+	bool console = false;
+	long long repeats = 0;
+	double seconds = 0;
+	long long moves = 0;     //Moves made over all repeats
+	long long allocations = 0;
+};
+
+
+//Class running the benchmark cases and collecting their results
+class Benchmark
+{
+private:
+	vector<BenchResult> results;
+	double minSeconds;     //Repeat each case until it has run this long
+	long long consoleRounds; //Longest game timed with console output enabled
+	bool showConsole;      //Send the console output of the games to stdout instead of discarding it
+	uint64_t seed;
+	NullBuffer sink;
+	ostream discard;       //Console output of the games when it is not shown
+
+	//Time repeated calls of play until minSeconds have passed; play returns the moves it made
+	template <typename Play>
+	void measure(BenchResult result, Play play)
+	{
+		long long allocationsBefore = allocationCount.load();
+		auto start = chrono::steady_clock::now();
+		double elapsed = 0;
+
+		do
+		{
+			result.moves += play();
+			result.repeats++;
+			elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		} while (elapsed < minSeconds);
+
+		result.allocations = allocationCount.load() - allocationsBefore;
+		result.seconds = elapsed;
+
+		double nsPerMove = result.moves > 0 ? elapsed * 1e9 / (double)result.moves : 0;
+		cerr << "engine=" << result.engine << " pairing=" << result.pairing << " players=" << result.players
+			<< " rounds=" << result.rounds << " console=" << (result.console ? "on" : "off")
+			<< " repeats=" << result.repeats << " ns_per_move=" << nsPerMove << endl;
+
+		results.push_back(result);
+	}
+
+	//Play one game through Game::simulate, the path the interactive menu takes
+	long long playGame(const string& codes, long long rounds, ostream* console, bool useKernels)
+	{
+		Game G;
+		int numOfPlayers = (int)codes.size();
+
+		G.createPlayers(numOfPlayers);
+
+		for (int i = 0; i < numOfPlayers; i++)
+		{
+			G.getPlayerInfo()[i].updateStrategy(codes[i]);
+			G.getPlayerInfo()[i].setFirstMove('c');
+		}
+
+		G.setSeed(seed);
+		G.setNumberOfRounds((int)rounds);
+		G.setLog(console);
+		G.setUseKernels(useKernels);
+		G.simulate();
+
+		return rounds * numOfPlayers * (numOfPlayers - 1);
+	}
+
+	//Start an AsyncLog on stdout or, when the console is not shown, on the null device
+	void openLog(AsyncLog& log)
+	{
+		if (showConsole)
+		{
+			log.openStdout();
+		}
+		else
+		{
+#ifdef _WIN32
+			log.open("NUL");
+#else
+			log.open("/dev/null");
+#endif
+		}
+	}
+
+	//Time repeated games with their console output going through one AsyncLog, as a verbose run
+	//does; starting and stopping the writer thread is timed on its own by runLogStartup
+	void measureAsync(const BenchResult& result, const string& codes, long long rounds)
+	{
+		AsyncLog log;
+		openLog(log);
+		AsyncLogStream stream(log);
+
+		measure(result, [&]()
+		{
+			long long moves = playGame(codes, rounds, &stream, false);
+			stream.flush();
+			return moves;
+		});
+
+		stream.flush();
+		log.close();
+	}
+
+	//Console output target of the synchronous game cases
+	ostream* console()
+	{
+		return showConsole ? &cout : &discard;
+	}
+
+public:
+	//Default Constructor
+	Benchmark() : discard(&sink)
+	{
+		minSeconds = 0.2;
+		consoleRounds = 100000;
+		showConsole = false;
+		seed = 1;
+	}
+
+	void setMinSeconds(double seconds)
+	{
+		minSeconds = seconds;
+	}
+
+	void setConsoleRounds(long long rounds)
+	{
+		consoleRounds = rounds;
+	}
+
+	void setShowConsole(bool show)
+	{
+		showConsole = show;
+	}
+
+	void setSeed(uint64_t newSeed)
+	{
+		seed = newSeed;
+	}
+
+	//Time every engine on one pairing of built-in strategies over the given number of rounds
+	void runPairing(char a, char b, long long rounds)
+	{
+		string pairing = string(1, a) + "-" + b;
+		BenchResult result;
+		result.pairing = pairing;
+		result.rounds = rounds;
+
+		MatchConfig config;
+		config.strategyA = a;
+		config.strategyB = b;
+		config.rounds = rounds;
+		config.seed = seed;
+		config.idA = 0;
+		config.idB = 1;
+
+		if (rounds <= consoleRounds)
+		{
+			result.engine = "game";
+			result.console = true;
+			measure(result, [&]() { return playGame(string(1, b) + a, rounds, console(), false); });
+
+			result.engine = "game-async";
+			measureAsync(result, string(1, b) + a, rounds);
+		}
+
+		result.console = false;
+		result.engine = "game";
+		measure(result, [&]() { return playGame(string(1, b) + a, rounds, nullptr, false); });
+
+		result.engine = "game-kernel";
+		measure(result, [&]() { return playGame(string(1, b) + a, rounds, nullptr, true); });
+
+		result.engine = "generic";
+		measure(result, [&]() { playMatchGeneric(config); return 2 * rounds; });
+
+		result.engine = "kernel";
+		measure(result, [&]() { playMatch(config); return 2 * rounds; });
+
+		//Implementation noise at a typical rate: the flips come from geometric gaps, not per-move draws
+		MatchConfig noisy = config;
+		noisy.noiseA = noisy.noiseB = 0.01;
+
+		result.engine = "kernel-noise";
+		measure(result, [&]() { playMatch(noisy); return 2 * rounds; });
+
+		//Expected scores from the Markov chain of the pairing, in O(log rounds) for any length
+		result.engine = "analytic";
+		measure(result, [&]()
+		{
+			MarkovMatch chain;
+			string error;
+			chain.build(config, error);
+			chain.expected(rounds);
+			return 2 * rounds;
+		});
+	}
+
+	//Time opening and closing an AsyncLog with nothing written, the fixed cost of a verbose run;
+	//each repeat counts as one move, so ns_per_move is the time per open and close
+	void runLogStartup()
+	{
+		BenchResult result;
+		result.engine = "log-startup";
+		result.pairing = "none";
+		result.console = true;
+
+		measure(result, [&]()
+		{
+			AsyncLog log;
+			openLog(log);
+			log.close();
+			return 1LL;
+		});
+	}
+
+	//Time the game loop with several players, whose strategies cycle through r, c, e and t
+	void runPlayers(int numOfPlayers, long long rounds)
+	{
+		string codes;
+		for (int i = 0; i < numOfPlayers; i++)
+		{
+			codes += "rcet"[i % 4];
+		}
+
+		BenchResult result;
+		result.engine = "game";
+		result.pairing = "mixed";
+		result.players = numOfPlayers;
+		result.rounds = rounds;
+
+		if (rounds <= consoleRounds)
+		{
+			result.console = true;
+			measure(result, [&]() { return playGame(codes, rounds, console(), false); });
+
+			result.engine = "game-async";
+			measureAsync(result, codes, rounds);
+			result.engine = "game";
+		}
+
+		result.console = false;
+		measure(result, [&]() { return playGame(codes, rounds, nullptr, false); });
+	}
+
+	//Write the results as a JSON array of objects
+	bool writeJSON(const string& path) const
+	{
+		ofstream out(path);
+
+		if (!out)
+		{
+			cerr << "Error: Could not write " << path << endl;
+			return false;
+		}
+
+		out << "[\n";
+
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			const BenchResult& r = results[i];
+			double perSecond = r.seconds > 0 ? (double)(r.rounds * r.repeats) / r.seconds : 0;
+
+			out << "  {\"engine\": \"" << r.engine << "\", \"pairing\": \"" << r.pairing << "\", \"players\": " << r.players
+				<< ", \"rounds\": " << r.rounds << ", \"console\": " << (r.console ? "true" : "false")
+				<< ", \"repeats\": " << r.repeats << ", \"seconds\": " << r.seconds
+				<< ", \"rounds_per_s\": " << perSecond
+				<< ", \"ns_per_move\": " << (r.moves > 0 ? r.seconds * 1e9 / (double)r.moves : 0)
+				<< ", \"allocations_per_match\": " << (double)r.allocations / (double)r.repeats << "}"
+				<< (i + 1 < results.size() ? "," : "") << "\n";
+		}
+
+		out << "]\n";
+		return true;
+	}
+
+	//Write the results as CSV with a header row
+	bool writeCSV(const string& path) const
+	{
+		ofstream out(path);
+
+		if (!out)
+		{
+			cerr << "Error: Could not write " << path << endl;
+			return false;
+		}
+
+		out << "engine,pairing,players,rounds,console,repeats,seconds,rounds_per_s,ns_per_move,allocations_per_match\n";
+
+		for (const BenchResult& r : results)
+		{
+			double perSecond = r.seconds > 0 ? (double)(r.rounds * r.repeats) / r.seconds : 0;
+
+			out << r.engine << ',' << r.pairing << ',' << r.players << ',' << r.rounds << ',' << (r.console ? 1 : 0) << ','
+				<< r.repeats << ',' << r.seconds << ',' << perSecond << ','
+				<< (r.moves > 0 ? r.seconds * 1e9 / (double)r.moves : 0) << ','
+				<< (double)r.allocations / (double)r.repeats << '\n';
+		}
+
+		return true;
+	}
+};
+
+
+//Benchmark driver: every pairing of r, c, e and t at 10 to 10^8 rounds, then 2, 4 and 8 players
+int main(int argc, char* argv[])
+{
+	Benchmark B;
+	string jsonPath, csvPath;
+	long long maxRounds = 100000000;
+	const char codes[] = { 'r', 'c', 'e', 't' };
+
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		bool hasValue = (i + 1 < argc);
+
+		if (arg == "--json" && hasValue)
+		{
+			jsonPath = argv[++i];
+		}
+		else if (arg == "--csv" && hasValue)
+		{
+			csvPath = argv[++i];
+		}
+		else if (arg == "--max-rounds" && hasValue)
+		{
+			maxRounds = atoll(argv[++i]);
+		}
+		else if (arg == "--min-time" && hasValue)
+		{
+			B.setMinSeconds(atof(argv[++i]));
+		}
+		else if (arg == "--console-rounds" && hasValue)
+		{
+			B.setConsoleRounds(atoll(argv[++i]));
+		}
+		else if (arg == "--show-console")
+		{
+			B.setShowConsole(true);
+		}
+		else if (arg == "--seed" && hasValue)
+		{
+			B.setSeed(strtoull(argv[++i], nullptr, 10));
+		}
+		else
+		{
+			cerr << "Usage: " << argv[0] << " [--json FILE] [--csv FILE] [--max-rounds N] [--min-time SECONDS]" << endl;
+			cerr << "       [--console-rounds N] [--show-console] [--seed N]" << endl;
+			cerr << "Cases with console output run up to --console-rounds rounds (default 100000); their output is" << endl;
+			cerr << "formatted but discarded unless --show-console is given. Progress goes to stderr." << endl;
+			return (arg == "--help" || arg == "-h") ? 0 : 1;
+		}
+	}
+
+	for (long long rounds = 10; rounds <= maxRounds; rounds *= 100)
+	{
+		for (char a : codes)
+		{
+			for (char b : codes)
+			{
+				B.runPairing(a, b, rounds);
+			}
+		}
+	}
+
+	B.runLogStartup();
+
+	for (int numOfPlayers : { 2, 4, 8 })
+	{
+		for (long long rounds = 10; rounds <= min(maxRounds, 100000LL); rounds *= 100)
+		{
+			B.runPlayers(numOfPlayers, rounds);
+		}
+	}
+
+	if (!jsonPath.empty() && !B.writeJSON(jsonPath))
+	{
+		return 1;
+	}
+
+	if (!csvPath.empty() && !B.writeCSV(csvPath))
+	{
+		return 1;
+	}
+
+	return 0;
+}
@@ -21,1017 +21,2421 @@
 
 
 #include <iostream>
+#include <fstream>
 #include <cstdlib>
+#include <ctime>
+#include <chrono>
+#include <limits>
 #include <string>
-#define Max_Players 2
+#include <vector>
+#include <deque>
+#include <csignal>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+#include "PrisonersDilemma.h"
 
 using namespace std;
+using namespace ipd;
 
 //Function prototype for input validation.
 bool isInvalidInput();
 
-//Class for generating unique IDs
-class generateID
-{
-private:
-	static int ID;
+//Function prototype for the non-interactive batch mode.
+int runBatch(int argc, char* argv[]);
 
-public:
+//Function prototypes for the console prompts of the interactive game.
+void readPlayerNames(Game& G, int first, int last);
+void readFirstMoves(Game& G);
 
-	//Get the next available unique ID.
-	static int getID()
-	{
-		ID++;
-		return ID;
-	}
 
-	//Reset the static ID variable in the generateID class back to zero.
-	static void resetID()
+//Main function
+int main(int argc, char* argv[])
+{
+	//Any command-line argument selects the non-interactive batch mode
+	if (argc > 1)
 	{
-		ID = 0;
+		return runBatch(argc, argv);
 	}
-};
 
-//Initializing static member ID of generateID class
-int generateID::ID = 0;
+	//Declare and Initialize Variables
+	int choice1 = 0, choice2 = 0;
+	char choice3;
+	int numOfPlayers = 0;
+	int numOfRounds = 0;
+	int addPlayers = 0; 
+	string name = "";
 
-//Class defining different strategies for the players
-class Strategy
-{
-private:
-	char strategyCode;
+	//Flags to track which steps have been completed
+	bool playersCreated = false;
+	bool setNumberOfRounds = false;
+	bool setStrategy = false;
 
+	//Create a Game Object
+	Game G;
 
-public:
-	//Default Constructor
-	Strategy()
-	{
-		strategyCode = 'r'; //Default strategy is Random
-	}
+	//Seed the random streams for generating random moves in the game
+	G.setSeed((uint64_t)time(NULL));
 
+	//Show every round as it is played
+	G.setLog(&cout);
 
-	//Setter for strategyCode
-	void setStrategyCode(char code)
-	{
-		strategyCode = code;
-	}
 
-	//Getter for strategyCode
-	char getStrategyCode()
-	{
-		return strategyCode;
-	}
+	//User Interface
+	do
+	{	
+		//Display menu options
+		cout << endl;
+		cout << "---------------------------------------------------" << endl;
+		cout << "            ITERATED PRISONER'S DILEMMA            " << endl;
+		cout << "---------------------------------------------------" << endl;
+		cout << "1. Add/Drop Players" << endl;
+		cout << "2. Set Number of Rounds" << endl;
+		cout << "3. Choose your Game Strategy" << endl;
+		cout << "4. Start the Game" << endl;
+		cout << "5. Exit" << endl;
+		cout << "Enter your choice (1-5): ";
+		cin >> choice1;
+		cout << endl;		
 
-	//Function to determine the move based on the strategy
-	char cooperateOrDefect(char opponentLastMove)
-	{
-		switch (strategyCode)
+
+		switch (choice1)
 		{
 
-			case 'r':  // Random
+			case 1:
 			{
-				if (rand() % 2 == 0) {
-					return 'c';
-				}
-				else {
-					return 'd';
-				}
-			}
-
-			case 'c':  // Cooperate
-				return 'c';
+				//Option 1: Add/Drop Players
 
-			case 'e':  // Evil
-				return 'd';
+				cout << endl;
+				cout << "1. Add New Players to the Game (Begin/Reset Game)" << endl;
+				cout << "2. Add Players to the Existing Game" << endl;
+				cout << "3. Drop Players" << endl;
+				cout << "Enter your choice (1-3): ";
+				cin >> choice2;
 
-			case 't':  // Tit for Tat
-				return opponentLastMove;
+				while (isInvalidInput() || (choice2 != 1 && choice2 != 2 && choice2 != 3))
+				{
+					cout << "Invalid Choice! Please enter either 1,2 or 3: ";
+					cin >> choice2;
+				}
 
-			default:
-			{
-				cout << "Error: Invalid Strategy Code" << endl;
-				return '\0';
-			}
-		}
-	}
 
-};
+				if (choice2 == 1)
+				{
+					//Add Players
+					cout << "Enter the number of players (exactly 2 players required): " << endl;
+					cin >> numOfPlayers; 
 
+					while (isInvalidInput() || numOfPlayers != Max_Players)
+					{
+						cout << "Error! Please enter exactly 2 players: ";
+						cin >> numOfPlayers;
+					}
 
-//Class representing player in the game.
-class Player
-{
-private:
-	int ID;
-	string name;
-	int score;
-	int numOfMoves;
-	int totalMoves;
-	char* prevMoves;
-	Strategy s;
-	static int numOfPlayers;
+					//Number of players can be increased by modifying the condition of the while loop
 
+					//Add new players to the game
+					G.createPlayers(numOfPlayers);
+					readPlayerNames(G, 0, numOfPlayers);
+					playersCreated = true;
+				}
 
-public:
-	//Default Constructor
-	Player()
-	{
-		ID = generateID::getID();
-		name = "";
-		score = 0;
-		numOfMoves = 0;
-		totalMoves = 0;
-		prevMoves = nullptr;
-		numOfPlayers++;
-	}
+				
+				else if (choice2 == 2)
+				{
+					if (!playersCreated)
+					{
+						cout << "Error: Create the players first (Option 1)!" << endl;
+						break;
+					}
 
+					
+					if (numOfPlayers == Max_Players)
+					{
+						cout << "Error! Max Limit Reached! Could not add new players";
+						break;
+					}
 
-	//Copy Constructor
-	Player(const Player& other)
-	{
-		//Copy primitive data members
-		ID = other.ID;
-		name = other.name;
-		score = other.score;
-		numOfMoves = other.numOfMoves;
-		totalMoves = other.totalMoves;
+					bool maxReached = false;
 
-		if (other.prevMoves != nullptr)
-		{
-			prevMoves = other.prevMoves;
-		}
 
-		else
-		{
-			prevMoves = nullptr;
-		}
+					cout << "Enter the number of players to add to the game" << endl;
+					cin >> addPlayers;
 
-		//Copy strategy (assuming that Strategy has an appropriate copy constructor)
-		s = other.s;
-	}
+					while (isInvalidInput() || addPlayers < 1 || (numOfPlayers + addPlayers) > 2)
+					{
+						if (addPlayers < 1)
+						{
+							cout << "Please enter at least one player to add: " << endl;
+							cin >> addPlayers;
+						}
 
-	//Accessors
-	int getID()
-	{
-		return ID;
-	}
+						else if ((numOfPlayers + addPlayers) > 2)
+						{
+							//For the context of this assignment, the number of players has to be 2
+							cout << "Please enter a maximum of 2 players to start the game(enter exactly 2 players): ";
+							cin >> addPlayers;
+							maxReached = true;
+							break;
 
-	string getName()
-	{
-		return name;
-	}
+						}
+					}
 
-	int getScore()
-	{
-		return score;
-	}
+					if (!maxReached) //Executes if and only if number of players is within the allowed limit
+					{
+						//Add additional players to the game
+						if (G.addPlayersToExistingGame(addPlayers))
+						{
+							readPlayerNames(G, numOfPlayers, numOfPlayers + addPlayers);
+							numOfPlayers += addPlayers;
+						}
 
-	char getStrategy()
-	{
-		return s.getStrategyCode();
-	}
+						else
+						{
+							cout << "Error! Max Limit Reached! Could not add new players" << endl;
+						}
+					}
 
-	int getNumOfMoves() {
-		return numOfMoves;
-	}
+					else
+					{
+						continue;
+					}
 
-	char getLastMove(int x)
-	{
-		if (prevMoves != nullptr && x >= 0 && x < numOfMoves) 
-		{
-			return prevMoves[numOfMoves - (numOfPlayers - 1) + x];
-		}
-		else
-		{
-			cout << "Error! Cannot access last move";
-		}
-	}
+					break;
+				}
 
 
-	//Modifiers
-	void setName(string playerName)
-	{
-		name = playerName;
-	}
+				else if (choice2 == 3)
+				{
+					//Drop Players
+					if (!playersCreated)
+					{
+						cout << "Error: Create the players first (Option 1)!" << endl;
+						break;
+					}
 
-	void setNumberOfMoves(int initTotalMoves)
-	{
-		//Calculating total moves considering we do not know that the number of players is 2
-		totalMoves = initTotalMoves * (numOfPlayers - 1); 
+					int pID;
 
-		prevMoves = new char[totalMoves];
+					cout << "Enter the ID of the player you want to drop: " << endl;
+					cin >> pID;
 
-	}
+					while (isInvalidInput() || pID < 0)
+					{
+						cout << "Please enter a non-negative integer value for ID: ";
+						cin >> pID;
+					}
 
+					//Drop the specified player
+					if (G.dropPlayer(pID))
+					{
+						cout << "Player " << pID << " successfully deleted" << endl;
+						numOfPlayers--;
+					}
 
-	void updateStrategy(char code)
-	{
-		s.setStrategyCode(code);
-	}
+					else
+					{
+						cout << "Player " << pID << " not found" << endl;
+					}
+				}
 
-	char makeMove(char opponentMove)
-	{
-		char move = s.cooperateOrDefect(opponentMove);
+				break;
+			}
 
-		printMoves(move);
-		
-		if (numOfMoves <= totalMoves)
-		{
-			setLastMove(move);
-		}
-		else
-		{
-			cout << "Error: Too many moves made. Move index out of bounds." << endl;
-		}
-		return move;
-	}
+			case 2:
+			{
+				//Option 2: Set Number of Rounds
 
+				//Ensure players are created before setting the number of rounds
+				if (!playersCreated)
+				{
+					cout << "Error: Create the players first (Option 1)!" << endl;
+					break;
+				}
 
-	void setLastMove(char newMove)
-	{
-		prevMoves[numOfMoves] = newMove;
-		numOfMoves++;
-	}
+				bool flag = true;
 
 
-	//Functions
-	void printMoves(char move)
-	{
-		if (move == 'c')
-		{
-			cout << "Player " << ID << " Move: Cooperate" << endl;
-			cout << endl;
-		}
+				if (!flag)
+				{
+					for (int i = 0; i < numOfPlayers; i++)
+					{
+						//Deallocate memory for the player's previous moves
+						G.getPlayerInfo()[i].resetMoves();
 
-		else
-		{
-			cout << "Player " << ID << " Move: Defect" << endl;
-			cout << endl;
-		}
-	}
+					}
 
-	void increaseScore(int newScore)
-	{
-		score += newScore;
-	}
+					flag = true;
 
-	void resetData()
-	{
-		score = 0;
-		numOfMoves = 0;
-	}
+				}
 
-	char* resetMoves()
-	{
-		return prevMoves;
-	}
+				cout << "Enter the number of rounds: ";
+				cin >> numOfRounds;
 
-	static void resetNumOfPlayers()
-	{
-		numOfPlayers = 0;
-	}
+				while (isInvalidInput() || numOfRounds <= 0)
+				{
+					cout << "Please enter a positive value for number of rounds: ";
+					cin >> numOfRounds;
+				}
 
-	//Destructor
-	~Player()
-	{
-		delete[] prevMoves; // Deallocate memory for prevMoves array
-	}
-};
+				//Set the number of rounds in the game
+				G.setNumberOfRounds(numOfRounds);
 
-//Initializing static member numOfPlayers of Player class
-int Player::numOfPlayers = 0;
+				setNumberOfRounds = true;
+				flag = false;
+				break;
+			}
 
 
-//Class representing the game and its operations.
-class Game
-{
-private:
-	Player* players; //Array to store player objects
-	int numOfPlayers;
-	int numOfRounds;
-	char strategy;
+			case 3:
+			{
+				//Option 3: Choose your game strategy
 
-public:
+				//Ensure players and the number of rounds are set before choosing strategies.
+				if (!playersCreated || !setNumberOfRounds)
+				{
+					cout << "Error: Create the players, and set the number of rounds first (Options 1, and 2)!" << endl;
+					break;
+				}
 
-	//Default Constructor
-	Game()
-	{
-		players = nullptr;
-		numOfPlayers = 0;
-		numOfRounds = 0;
-	}
+				//Display available game strategies
+				cout << endl;
+				cout << "==================================" << endl;
+				cout << "          GAME STRATEGIES         " << endl;
+				cout << "==================================" << endl;
+				cout << "Enter r for Random" << endl;
+				cout << "Enter c for Cooperate" << endl;
+				cout << "Enter e for Evil" << endl;
+				cout << "Enter t for Tit for Tat" << endl;
+				cout << endl;
 
-	//Set the number of rounds and allocate memory for each player's moves
-	void setNumberOfRounds(int rounds)
-	{
-		numOfRounds = rounds;
 
-		
-		//Allocate memory for each player's moves
-		for (int i = 0; i < numOfPlayers; i++)
-		{	
-			// Reset player-specific data
-			players[i].resetData();
+				//Prompt each player to choose a strategy
+				for (int i = 0; i < numOfPlayers; i++)
+				{
+					do
+					{
+						cout << "Player " << i + 1 << " , Please choose your strategy: ";
+						cin >> choice3;
 
-			// Set the number of moves for each player based on the specified rounds
-			players[i].setNumberOfMoves(rounds);
-		}
-	}
+						if (choice3 != 'r' && choice3 != 'c' && choice3 != 'e' && choice3 != 't')
+						{
+							cout << "Please either 'r', 'c', 'e', or 't' for your strategy : " << endl;
+						}
 
+						cin.clear();
+						cin.ignore(numeric_limits<streamsize>::max(), '\n');
 
-	//Display the result of the game
-	void displayResult()
-	{
-		int winnerID = -1, highestScore = -1;
-		int* tiedPlayers = new int[numOfPlayers];  //Dynamic array to store IDs of tied players
-		int numTiedPlayers = 0;
-		string winner;
+					} while (isInvalidInput() || (choice3 != 'r' && choice3 != 'c' && choice3 != 'e' && choice3 != 't'));
 
-		cout << endl;
-		cout << "*********************************" << endl;
-		cout << endl;
+					//Set the chosen strategy for the player
+					G.getPlayerInfo()[i].updateStrategy(choice3);
 
-		for (int i = 0; i < numOfPlayers; i++)
-		{
-			//Display player information
-			cout << "Player ID: " << players[i].getID() << endl;
-			cout << "Name: " << players[i].getName() << endl;
-			cout << "Score: " << players[i].getScore() << endl;
-			cout << endl;
-			
-			//Check for the winner
-			if (players[i].getScore() > highestScore)
-			{
-				//Reset tied player count if a new highest score is found
-				numTiedPlayers = 0;  
-				tiedPlayers[numTiedPlayers++] = players[i].getID();
-				winnerID = players[i].getID();
-				winner = players[i].getName();
-				highestScore = players[i].getScore();
+				}
+
+				setStrategy = true;
+				break;
 			}
 
-			else if (players[i].getScore() == highestScore)
+			case 4:
 			{
-				if (numTiedPlayers == 0)  //Allocate memory only if it's the first tie
-					tiedPlayers = new int[numOfPlayers];
-
-				//Store the ID of a tied player
-				tiedPlayers[numTiedPlayers++] = players[i].getID();
-			}
+				//Option 4: Start the game
 
-		}
+				//Ensure players, the number of rounds, and strategies are set before starting the game.
+				if (!playersCreated || !setNumberOfRounds || !setStrategy)
+				{
+					cout << "Error: Create the players, set the number of rounds, and choose strategy first (Options 1, 2, and 3)!" << endl;
+					break;
+				}
 
-		cout << "*********************************" << endl;
-		cout << endl;
+				//Ask tit for tat players for their first move, then start the game
+				readFirstMoves(G);
+				G.simulate();
 
-		//Display Result
-		cout << "------------------------------------" << endl;
-		cout << "|              RESULT              |" << endl;
-		cout << "------------------------------------" << endl;
+				// Display the final result of the game
+				G.displayResult(cout);
 
-		//Check if there is a single winner or a tie
-		if (numTiedPlayers == 1)
-		{
-			//Display information for a single winner
-			cout << "|WinnerID: " << winnerID << "                       |" << endl;
-			cout << "|Name: " << winner << "                           |" << endl;
-			cout << "|Score: " << highestScore << "                         |" << endl;
-		}
+				break;
+			}
 
-		else
-		{
-			//Display information for a tie
-			cout << "|It's a tie                        |" << endl;
-			cout << "|                                  |" << endl;
-			cout << "|Tied Players:                     |" << endl;
 
-			for (int i = 0; i < numTiedPlayers; i++)
+			case 5:
 			{
+				//Option 5: Exit
 
-				cout << "|Player " << tiedPlayers[i] << "                          |" << endl;
-			}
-
-			cout << "|                                  |" << endl;
+				cout << "Thank you for playing!" << endl;
 
-			cout << "|Score of each player: " << highestScore << "          |" << endl;
-		}
+				cout << endl;
 
-		cout << "------------------------------------" << endl;
+				cout << "End of the program!" << endl;
+				break;
+			}
 
-		cout << endl;
 
-		//Deallocate memory for tiedPlayers array
-		delete[] tiedPlayers;
-	}
+			default:
+			{
+				//Handle invalid choices
+				cout << "Invalid Choice! Please enter either 1, 2, 3, 4, or 5. ";
 
-	//Add players to the game
-	void addPlayers(int numPlayers)
-	{
-		//Release memory if players array is not null
-		if (players != nullptr)
-		{
-			delete[] players;
-			generateID::resetID();
-			Player::resetNumOfPlayers();
+				//Clears the input buffer
+				cin.clear();
 
+				//To ensure that error message is printed only once
+				cin.ignore(numeric_limits<streamsize>::max(), '\n');
+				continue;
+			}
 		}
 
-		players = new Player[numPlayers];
-		numOfPlayers = numPlayers;
-
-		//Clear any remaining newline characters in the input buffer.
-		cin.ignore();
+	} while (choice1 != 5);
 
-		for (int i = 0; i < numOfPlayers; i++)
-		{
-			string playerName;
+	return 0;
+}
 
-			cout << "Enter the name for Player " << i + 1 << ": ";
 
-			//Use getline to read the entire line, allowing names with spaces.
-			getline(cin, playerName);
-			
+//Function to check if the input is valid
+bool isInvalidInput()
+{
+	bool invalidInput = false;
 
-			while (isInvalidInput())
-			{
-				cout << "Please enter a string value for the name of the player: ";
+	//Check for invalid input
+	if (cin.fail())
+	{
+		invalidInput = true;
+		cout << "Error! Invalid Input! Please enter a valid numeric input!" << endl;
+		cout << endl;
 
-				//Use getline to read the entire line, allowing names with spaces.
-				getline(cin, playerName);
-			}
+		//Clears the input buffer
+		cin.clear();
 
-			players[i].setName(playerName);
+		//To ensure that error message is printed only once
+		cin.ignore(numeric_limits<streamsize>::max(), '\n');
 
-			cout << "Players added successfully!" << endl;
-			cout << endl;
-		}
 	}
 
-
-	void addPlayersToExistingGame(int numOfPlayersToAdd)
+	else
 	{
-		//Ensure that game already exists
-		if (players != nullptr)
-		{
-			//Check if the total number of players after adding new players is within the allowable limit
-			if ((numOfPlayers + numOfPlayersToAdd) <= Max_Players)
-			{
-				//Create a temporary array to hold the updated players
-				Player* updatePlayers = new Player[numOfPlayers + numOfPlayersToAdd];
+		invalidInput = false;
+	}
 
-				//Copy existing players data to the updated array and reset their individual data
-				for (int i = 0; i < numOfPlayers; i++)
-				{
-					updatePlayers[i] = players[i];
-					updatePlayers[i].resetData();
+	return invalidInput;
+}
 
-				}
 
-				//Deallocate the memory for players array
-				delete[] players;
+//Prompt for the names of players first to last - 1
+void readPlayerNames(Game& G, int first, int last)
+{
+	//Clear any remaining newline characters in the input buffer.
+	cin.ignore();
 
-				//Assign the updated array to Players
-				players = updatePlayers;
+	for (int i = first; i < last; i++)
+	{
+		string playerName;
 
-				//Update the total number of players
-				numOfPlayers += numOfPlayersToAdd;
-			}
+		cout << "Enter the name for Player " << i + 1 << ": ";
 
-			else
-			{
-				cout << "Error! Max Limit Reached! Could not add new players" << endl;
-			}
- 
-		}
+		//Use getline to read the entire line, allowing names with spaces.
+		getline(cin, playerName);
 
-		//Ignore any remaining characters in the input buffer
-		cin.ignore();
 
-		for (int i = (numOfPlayers - numOfPlayersToAdd); i < numOfPlayers ; i++)
+		while (isInvalidInput())
 		{
-			string playerName;
-
-			cout << "Enter the name of Player: ";
+			cout << "Please enter a string value for the name of the player: ";
 
 			//Use getline to read the entire line, allowing names with spaces.
 			getline(cin, playerName);
-
-
-			while (isInvalidInput())
-			{
-				cout << "Please enter a string value for the name of the player: ";
-
-				//Use getline to read the entire line, allowing names with spaces.
-				getline(cin, playerName);
-			}
-
-			players[i].setName(playerName);
-
-			cout << "Players added successfully!" << endl;
-			cout << endl;
 		}
 
+		G.getPlayerInfo()[i].setName(playerName);
 
+		cout << "Players added successfully!" << endl;
+		cout << endl;
 	}
+}
 
-	//Drop a player from the game
-	void dropPlayer(int playerID)
-	{
-		bool flag = false;
-
-		for (int i = 0; i < numOfPlayers; ++i) {
-			if (players[i].getID() == playerID) {
-				for (int j = i; j < numOfPlayers - 1; j++)
-				{
-					players[j] = players[j + 1];
-				}
-
-				//Initialize last player object to zero in order to remove duplicate player objects
-				players[numOfPlayers - 1] = Player();
-				numOfPlayers--;
-
-				flag = true;
-				cout << "Player " << playerID << " successfully deleted" << endl;
-
-				//Dynamic memory allocated to the dropped player object is deallocated at the end of main
-
-				break;
-			}
-		}
 
-		if (flag == false)
+//Ask every tit for tat player for the move they open the game with
+void readFirstMoves(Game& G)
+{
+	for (int i = 0; i < G.getNumOfPlayers(); i++)
+	{
+		if (G.getPlayerInfo()[i].getStrategy() != 't')
 		{
-			cout << "Player " << playerID << " not found" << endl;
+			continue;
 		}
-	}
-
-
-	//Get information about the players
-	Player* getPlayerInfo() {
-		return players;
-	}
 
+		char firstMove = 'c';
 
-	//Start the game
-	void play()
-	{
+		cout << "Player " << i + 1 << ", please enter your first move: Enter 'c' for cooperate or 'd' for defect: ";
+		cin >> firstMove;
 
-		for (int i = 0; i < numOfRounds; i++)
+		while (isInvalidInput() || (firstMove != 'c' && firstMove != 'd'))
 		{
-			for (int j = 0; j < numOfPlayers; j++)
-			{
-				int x = 0;
+			cout << "Please enter either 'c' or 'd' for your first move: ";
+			cin >> firstMove;
+		}
 
-				for (int k = 0; k < j; k++)
-				{
-					cout << "----------------------------------" << endl;
-					cout << "              Round " << i + 1 << "             " << endl;
-					cout << "----------------------------------" << endl;
-					cout << endl;
+		G.getPlayerInfo()[i].setFirstMove(firstMove);
+	}
 
-					//Stores Player Moves
-					char playerOne = 'c';
-					char playerTwo = 'c';
+	cout << endl;
+}
 
-					if (i == 0)
-					{
-						//For the first round, the opponent's last move is set as 'c'.
-						//This does not impact the outcome since we only need the last move if the user chooses "tit for tat."
-						//If the user chooses "tit for tat," the program prompts the user for their first move.
-						//Otherwise, the first move is determined based on the player's selected strategy.
-						char defaultChar = 'c';
 
+//Settings for one non-interactive run, filled from the command line and/or a config file
+struct BatchConfig
+{
+	long long numOfRounds = 0;
+	bool verbose = false;
+	bool tournament = false;
+	int numOfThreads = 0; //0 means one per hardware thread
+	int numOfEntrants = 0; //Generated entrants in addition to the listed players
+	int top = 10;
+	bool hasSeed = false;
+	uint64_t seed = 0;
+	bool specialized = true; //Tournament kernel: specialised per pair or generic
+	long long numOfRepeats = 0; //Monte Carlo mode: matches of the single pairing to play
+	bool verify = false; //Monte Carlo mode: check every match against the scalar engine
+	vector<string> names;
+	vector<char> strategies;
+	vector<char> firstMoves;
+	vector<string> tableNames; //Table strategy of each player, empty for a built-in code
+	vector<string> strategyFiles; //Table strategies to load; each one also joins a tournament
+	long long generations = 0; //Evolution mode: generations to run
+	long long populationSize = 1000;
+	bool moran = true; //Evolution dynamics: Moran process or discrete replicator
+	double selection = 1.0;
+	double mutation = 0.0;
+	int samples = 1; //Matches averaged per pair of types
+	long long report = 0; //Print the population every this many generations (0 = only at the end)
+	long long latticeSize = 0; //Spatial mode: side of the square grid
+	int neighbours = 8;
+	long long searchGenerations = 0; //Genetic search mode: generations to breed
+	int memory = 1; //Genetic search: memory depth of the evolved strategies
+	string tracePath; //Single game: binary trace of every move, empty for none
+	string logPath; //Single game: file receiving the verbose output instead of stdout
+	string metricsPath; //Instrumented builds: file receiving the metrics instead of stderr
+	PayoffMatrix payoffMatrix = defaultPayoffs; //Payoffs of every mode, validated when given
+	double noise = 0; //Probability that a move is flipped, for every player without a rate of its own
+	vector<pair<string, double>> playerNoise; //Error rates of single players by name
+	bool analytic = false; //Compute expected scores from the Markov chain of each pairing
+	double discount = -1; //Analytic mode: also report the discounted payoff for this continuation probability
+	double ciWidth = 0; //Replicate mode: stop when every confidence interval is narrower than this
+	double confidence = 0.95;
+	long long minReplicates = 10;
+	long long maxReplicates = 100000;
+	string checkpointPath; //Tournament mode: file the progress is saved to, empty for none
+	double checkpointInterval = 60; //Seconds between checkpoints
+	string resumePath; //Tournament mode: checkpoint to continue from
+	int workers = 0; //Tournament mode: worker processes sharing the pairings (0 = this process only)
+	bool shardWorker = false; //Serve shards to a coordinator over stdin and stdout
+	vector<string> arguments; //Command line, rerun by worker processes
+	bool cache = false; //Look match outcomes up before playing them
+	string cachePath; //File the outcome cache is loaded from and saved to, empty to keep it in memory
+	OutcomeCache* outcomes = nullptr; //The cache itself while a mode runs
+	LogLevel logLevel = LogMoves;
+};
 
-						if (players[j].getStrategy() == 't')
-						{
-							cout << "Player " << j + 1 << ", please enter your first move: Enter 'c' for cooperate or 'd' for defect: ";
-							cin >> defaultChar;
+//Check that a strategy code is one of the supported strategies
+bool isValidStrategy(char code)
+{
+	return code == 'r' || code == 'c' || code == 'e' || code == 't';
+}
 
-							while (isInvalidInput() || (defaultChar != 'c' && defaultChar != 'd'))
-							{
-								cout << "Please enter either 'c' or 'd' for your first move: ";
-								cin >> defaultChar;
-							}
+//Parse a player given as NAME:STRATEGY[:FIRSTMOVE] and append it to the config
+bool addBatchPlayer(BatchConfig& config, const string& spec)
+{
+	size_t first = spec.find(':');
 
+	if (first == string::npos || first == 0 || first + 1 >= spec.size())
+	{
+		cerr << "Error: Player must be given as NAME:STRATEGY[:FIRSTMOVE], got '" << spec << "'" << endl;
+		return false;
+	}
 
-							playerOne = players[j].makeMove(defaultChar);
-						}
+	size_t second = spec.find(':', first + 1);
+	string strategy = spec.substr(first + 1, second == string::npos ? string::npos : second - first - 1);
+	char code = strategy[0];
+	char firstMove = 'c';
 
-						else
-						{
-							playerOne = players[j].makeMove(defaultChar); //If selected strategy is not tit for tat
-						}
+	if (second != string::npos)
+	{
+		if (spec.size() != second + 2)
+		{
+			cerr << "Error: Invalid player specification '" << spec << "'" << endl;
+			return false;
+		}
 
+		firstMove = spec[second + 1];
+	}
 
-						if (players[k].getStrategy() == 't')
-						{
-							cout << "Player " << k + 1 << ", please enter your first move: Enter 'c' for cooperate or 'd' for defect: ";
-							cin >> defaultChar;
+	//Longer names refer to table strategies, resolved once the strategy files are loaded
+	string tableName;
+	if (strategy.size() > 1)
+	{
+		tableName = strategy;
+		code = '*';
+	}
 
-							while (isInvalidInput() || (defaultChar != 'c' && defaultChar != 'd'))
-							{
-								cout << "Please enter either 'c' or 'd' for your first move: ";
-								cin >> defaultChar;
-							}
+	else if (!isValidStrategy(code))
+	{
+		cerr << "Error: Invalid strategy '" << code << "' for player '" << spec.substr(0, first) << "'" << endl;
+		return false;
+	}
 
-							playerTwo = players[k].makeMove(defaultChar);
-						}
+	if (firstMove != 'c' && firstMove != 'd')
+	{
+		cerr << "Error: First move must be 'c' or 'd' for player '" << spec.substr(0, first) << "'" << endl;
+		return false;
+	}
 
-						else
-						{
-							playerTwo = players[k].makeMove(defaultChar); //If selected strategy is not tit for tat
-						}
+	config.names.push_back(spec.substr(0, first));
+	config.strategies.push_back(code);
+	config.firstMoves.push_back(firstMove);
+	config.tableNames.push_back(tableName);
+	return true;
+}
 
-					}
+//Parse an error rate given as E (every player) or NAME:E (one player) and add it to the config
+bool addNoise(BatchConfig& config, const string& spec)
+{
+	size_t colon = spec.rfind(':');
+	string rate = (colon == string::npos) ? spec : spec.substr(colon + 1);
+	char* end = nullptr;
+	double value = strtod(rate.c_str(), &end);
 
+	if (rate.empty() || *end != '\0' || !(value >= 0 && value <= 1) || colon == 0)
+	{
+		cerr << "Error: Noise must be given as E or NAME:E with 0 <= E <= 1, got '" << spec << "'" << endl;
+		return false;
+	}
 
-					else
-					{
-						int last_Move2 = players[k].getLastMove(x);
-						int last_Move1 = players[j].getLastMove(x);
+	if (colon == string::npos)
+	{
+		config.noise = value;
+	}
+	else
+	{
+		config.playerNoise.push_back(make_pair(spec.substr(0, colon), value));
+	}
 
-						playerOne = players[j].makeMove(last_Move2);
-						playerTwo = players[k].makeMove(last_Move1);
-					}
-				
-					x = x + 1;
+	return true;
+}
 
-					//Set Score based on moves
-					if (playerOne == 'c' && playerTwo == 'c')
-					{
-						players[j].increaseScore(3);
-						players[k].increaseScore(3);
-					}
-					else if (playerOne == 'c' && playerTwo == 'd')
-					{
-						players[j].increaseScore(0);
-						players[k].increaseScore(5);
-					}
-					else if (playerOne == 'd' && playerTwo == 'c')
-					{
-						players[j].increaseScore(5);
-						players[k].increaseScore(0);
-					}
-					else // move1 == 'd' && move2 == 'd'
-					{
-						players[j].increaseScore(1);
-						players[k].increaseScore(1);
-					}
+//Parse a selection strength or mutation rate, which must lie in [0, 1]
+bool parseRate(const string& name, const string& text, double& rate)
+{
+	char* end = nullptr;
+	double value = strtod(text.c_str(), &end);
 
-				}
-			}
+	if (text.empty() || *end != '\0' || !(value >= 0 && value <= 1))
+	{
+		cerr << "Error: " << name << " must be between 0 and 1, got '" << text << "'" << endl;
+		return false;
+	}
 
+	rate = value;
+	return true;
+}
 
-		}
-		displayResult(); // Display the final result of the game
-	}
+//Error rate of the named player: its own if one was given, otherwise the default
+double errorRateOf(const BatchConfig& config, const string& name)
+{
+	double rate = config.noise;
 
-	//Destructor
-	~Game() 
+	for (const pair<string, double>& entry : config.playerNoise)
 	{
-		delete[] players; //Deallocate memory for players array
+		if (entry.first == name)
+		{
+			rate = entry.second;
+		}
 	}
 
-};
-
+	return rate;
+}
 
-//Main function
-int main()
+//Read a config file of "rounds N", "player NAME:STRATEGY[:FIRSTMOVE]", "verbose",
+//"tournament", "threads N", "entrants N", "top N", "seed N", "kernel generic|specialized",
+//"montecarlo N", "verify", "strategies FILE", "evolve N", "population N", "dynamics moran|replicator",
+//"selection W", "mutation U", "samples N", "report N", "lattice N", "neighbours 4|8", "search G",
+//"memory N", "trace FILE", "log FILE", "log-level rounds|moves", "metrics FILE",
+//"payoffs R,S,T,P[/R,S,T,P]", "payoff-file FILE", "noise [NAME:]E", "ci-width W", "confidence C",
+//"replicates N", "min-replicates N", "analytic", "discount D", "checkpoint FILE", "checkpoint-every S"
+//"resume FILE", "workers N", "cache" and "cache-file FILE" lines
+bool loadBatchConfig(BatchConfig& config, const string& path)
 {
-	//Seed the random number generator for generating random moves in the game
-	srand(time(NULL));
-
-	//Declare and Initialize Variables
-	int choice1 = 0, choice2 = 0;
-	char choice3;
-	int numOfPlayers = 0;
-	int numOfRounds = 0;
-	int addPlayers = 0; 
-	string name = "";
+	ifstream file(path);
 
-	//Flags to track which steps have been completed
-	bool playersCreated = false;
-	bool setNumberOfRounds = false;
-	bool setStrategy = false;
+	if (!file)
+	{
+		cerr << "Error: Cannot open config file '" << path << "'" << endl;
+		return false;
+	}
 
-	//Create a Game Object
-	Game G;
+	string line;
+	int lineNumber = 0;
 
+	while (getline(file, line))
+	{
+		lineNumber++;
 
-	//User Interface
-	do
-	{	
-		//Display menu options
-		cout << endl;
-		cout << "---------------------------------------------------" << endl;
-		cout << "            ITERATED PRISONER'S DILEMMA            " << endl;
-		cout << "---------------------------------------------------" << endl;
-		cout << "1. Add/Drop Players" << endl;
-		cout << "2. Set Number of Rounds" << endl;
-		cout << "3. Choose your Game Strategy" << endl;
-		cout << "4. Start the Game" << endl;
-		cout << "5. Exit" << endl;
-		cout << "Enter your choice (1-5): ";
-		cin >> choice1;
-		cout << endl;		
+		//Skip blank lines and comments
+		size_t start = line.find_first_not_of(" \t\r");
+		if (start == string::npos || line[start] == '#')
+		{
+			continue;
+		}
 
+		istringstream fields(line);
+		string key, value;
+		fields >> key >> value;
 
-		switch (choice1)
+		if (key == "rounds")
+		{
+			config.numOfRounds = atoll(value.c_str());
+		}
+		else if (key == "tournament")
+		{
+			config.tournament = true;
+		}
+		else if (key == "threads")
+		{
+			config.numOfThreads = atoi(value.c_str());
+		}
+		else if (key == "entrants")
+		{
+			config.numOfEntrants = atoi(value.c_str());
+		}
+		else if (key == "top")
+		{
+			config.top = atoi(value.c_str());
+		}
+		else if (key == "strategies")
+		{
+			config.strategyFiles.push_back(value);
+		}
+		else if (key == "evolve")
+		{
+			config.generations = atoll(value.c_str());
+		}
+		else if (key == "population")
+		{
+			config.populationSize = atoll(value.c_str());
+		}
+		else if (key == "dynamics")
+		{
+			config.moran = (value != "replicator");
+		}
+		else if (key == "selection")
+		{
+			if (!parseRate("Selection", value, config.selection))
+			{
+				return false;
+			}
+		}
+		else if (key == "mutation")
+		{
+			if (!parseRate("Mutation", value, config.mutation))
+			{
+				return false;
+			}
+		}
+		else if (key == "samples")
+		{
+			config.samples = atoi(value.c_str());
+		}
+		else if (key == "report")
+		{
+			config.report = atoll(value.c_str());
+		}
+		else if (key == "lattice")
+		{
+			config.latticeSize = atoll(value.c_str());
+		}
+		else if (key == "neighbours")
+		{
+			config.neighbours = atoi(value.c_str());
+		}
+		else if (key == "search")
+		{
+			config.searchGenerations = atoll(value.c_str());
+		}
+		else if (key == "memory")
+		{
+			config.memory = atoi(value.c_str());
+		}
+		else if (key == "trace")
+		{
+			config.tracePath = value;
+		}
+		else if (key == "metrics")
+		{
+			config.metricsPath = value;
+		}
+		else if (key == "analytic")
+		{
+			config.analytic = true;
+		}
+		else if (key == "discount")
+		{
+			config.discount = atof(value.c_str());
+		}
+		else if (key == "ci-width")
+		{
+			config.ciWidth = atof(value.c_str());
+		}
+		else if (key == "confidence")
+		{
+			config.confidence = atof(value.c_str());
+		}
+		else if (key == "replicates")
+		{
+			config.maxReplicates = atoll(value.c_str());
+		}
+		else if (key == "min-replicates")
+		{
+			config.minReplicates = atoll(value.c_str());
+		}
+		else if (key == "checkpoint")
+		{
+			config.checkpointPath = value;
+		}
+		else if (key == "checkpoint-every")
+		{
+			config.checkpointInterval = atof(value.c_str());
+		}
+		else if (key == "resume")
+		{
+			config.resumePath = value;
+		}
+		else if (key == "workers")
+		{
+			config.workers = atoi(value.c_str());
+		}
+		else if (key == "cache")
+		{
+			config.cache = true;
+		}
+		else if (key == "cache-file")
+		{
+			config.cache = true;
+			config.cachePath = value;
+		}
+		else if (key == "noise")
+		{
+			if (!addNoise(config, value))
+			{
+				return false;
+			}
+		}
+		else if (key == "payoffs" || key == "payoff-file")
+		{
+			string error;
+			bool loaded = (key == "payoffs") ? PayoffMatrix::parse(value, config.payoffMatrix, error)
+				: PayoffMatrix::load(value, config.payoffMatrix, error);
+
+			if (!loaded)
+			{
+				cerr << "Error: " << error << " (line " << lineNumber << " of " << path << ")" << endl;
+				return false;
+			}
+		}
+		else if (key == "log")
+		{
+			config.logPath = value;
+		}
+		else if (key == "log-level")
+		{
+			config.logLevel = (value == "rounds") ? LogRounds : LogMoves;
+		}
+		else if (key == "montecarlo")
+		{
+			config.numOfRepeats = atoll(value.c_str());
+		}
+		else if (key == "verify")
+		{
+			config.verify = true;
+		}
+		else if (key == "kernel")
+		{
+			config.specialized = (value != "generic");
+		}
+		else if (key == "seed")
+		{
+			config.seed = strtoull(value.c_str(), nullptr, 10);
+			config.hasSeed = true;
+		}
+		else if (key == "player")
+		{
+			if (!addBatchPlayer(config, value))
+			{
+				return false;
+			}
+		}
+		else if (key == "verbose")
+		{
+			config.verbose = true;
+		}
+		else
+		{
+			cerr << "Error: Unknown setting '" << key << "' on line " << lineNumber << " of " << path << endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+//Print the command-line usage of the batch mode
+void printUsage(const char* program)
+{
+	cerr << "Usage: " << program << " [--config FILE] [--rounds N] [--player NAME:STRATEGY[:FIRSTMOVE]]... [--verbose]" << endl;
+	cerr << "       [--log FILE] [--log-level rounds|moves] [--trace FILE]" << endl;
+	cerr << "       " << program << " --tournament [--entrants N] [--threads N] [--top N] [--kernel generic|specialized] [--rounds N] [--player ...]..." << endl;
+	cerr << "       [--checkpoint FILE [--checkpoint-every SECONDS]] [--resume FILE]   (save progress; continue a stopped run)" << endl;
+	cerr << "       [--workers N]   (split the pairings into shards played by N worker processes)" << endl;
+	cerr << "       " << program << " --montecarlo N [--verify] [--rounds N] --player ... --player ..." << endl;
+	cerr << "       " << program << " --ci-width W [--confidence C] [--replicates MAX] [--min-replicates N] [--tournament]" << endl;
+	cerr << "       [--threads N] [--rounds N] [--player ...]...   (repeat a pairing or tournament until every CI is narrower than W)" << endl;
+	cerr << "       " << program << " --analytic [--discount D] [--verify [--montecarlo N]] [--tournament] [--rounds N] [--player ...]..." << endl;
+	cerr << "       (exact expected scores from the Markov chain of each pairing, optionally checked by simulation)" << endl;
+	cerr << "       " << program << " --evolve GENERATIONS [--population N] [--dynamics moran|replicator] [--selection W]" << endl;
+	cerr << "       [--mutation U] [--samples N] [--report N] [--threads N] [--rounds N] [--player ...]... [--strategies FILE]" << endl;
+	cerr << "       " << program << " --lattice N --evolve GENERATIONS [--neighbours 4|8] [--samples N] [--report N] [--threads N] [--rounds N] [--player ...]..." << endl;
+	cerr << "       " << program << " --search GENERATIONS [--memory 1-4] [--population N] [--mutation U] [--samples N] [--threads N] [--rounds N] [--player ...]..." << endl;
+	cerr << "Builds with IPD_METRICS report timings and counters to stderr, or to --metrics FILE." << endl;
+	cerr << "Any form accepts --payoffs R,S,T,P (default 3,0,5,1), or R,S,T,P/R,S,T,P for different row and" << endl;
+	cerr << "column players, or --payoff-file FILE; payoffs must satisfy T > R > P > S and 2R > T + S." << endl;
+	cerr << "--noise E flips each move with probability E; --noise NAME:E sets the rate of one player." << endl;
+	cerr << "--cache reuses the outcome of a match already played with the same strategies, rounds, noise and" << endl;
+	cerr << "payoffs (and seed, if it is random); --cache-file FILE keeps those outcomes between runs." << endl;
+	cerr << "Add --seed N to any form to make Random moves reproducible (the seed used is always printed)." << endl;
+	cerr << "Strategies: r (Random), c (Cooperate), e (Evil), t (Tit for Tat); FIRSTMOVE is c or d (default c)" << endl;
+	cerr << "Tournaments also accept table strategies by name (ALLC, ALLD, Random, TFT, STFT, WSLS, Pavlov," << endl;
+	cerr << "GTFT, TF2T, Grim) and --strategies FILE, whose strategies all join the tournament." << endl;
+	cerr << "Run without arguments for the interactive menu." << endl;
+}
+
+//Collect the entrants of a tournament or evolution run: the listed players (resolving table
+//strategy names), every strategy of the strategy files, then the generated entrants
+bool resolveEntrants(const BatchConfig& config, vector<StrategySpec>& entrants)
+{
+	StrategyLibrary library;
+	vector<shared_ptr<const StrategyTable>> loaded;
+	const char codes[] = { 'r', 'c', 'e', 't' };
+
+	for (const string& path : config.strategyFiles)
+	{
+		string error;
+
+		if (!library.load(path, loaded, error))
+		{
+			cerr << "Error: " << error << endl;
+			return false;
+		}
+	}
+
+	for (size_t i = 0; i < config.names.size(); i++)
+	{
+		StrategySpec spec;
+		spec.name = config.names[i];
+		spec.code = config.strategies[i];
+		spec.firstMove = config.firstMoves[i];
+
+		if (!config.tableNames[i].empty())
+		{
+			spec.table = library.find(config.tableNames[i]);
+
+			if (!spec.table)
+			{
+				cerr << "Error: Unknown strategy '" << config.tableNames[i] << "' for player '" << config.names[i] << "'" << endl;
+				return false;
+			}
+		}
+
+		entrants.push_back(spec);
+	}
+
+	for (const shared_ptr<const StrategyTable>& table : loaded)
+	{
+		StrategySpec spec;
+		spec.name = table->getName();
+		spec.code = '*';
+		spec.table = table;
+		entrants.push_back(spec);
+	}
+
+	//Generated entrants cycle through the built-in strategies
+	for (int i = 0; i < config.numOfEntrants; i++)
+	{
+		StrategySpec spec;
+		spec.name = "P" + to_string(i + 1);
+		spec.code = codes[i % 4];
+		entrants.push_back(spec);
+	}
+
+	for (StrategySpec& spec : entrants)
+	{
+		spec.noise = errorRateOf(config, spec.name);
+	}
+
+	return true;
+}
+
+//Number of worker threads requested, defaulting to one per hardware thread
+int getNumOfThreads(const BatchConfig& config)
+{
+	if (config.numOfThreads > 0)
+	{
+		return config.numOfThreads;
+	}
+
+	return max(1, (int)thread::hardware_concurrency());
+}
+
+//Enter the configured entrants into a tournament and set its parameters
+bool buildTournament(const BatchConfig& config, Tournament& T)
+{
+	vector<StrategySpec> entrants;
+
+	if (!resolveEntrants(config, entrants))
+	{
+		return false;
+	}
+
+	for (const StrategySpec& spec : entrants)
+	{
+		if (spec.table)
+		{
+			T.addEntrant(spec.name, spec.table);
+		}
+		else
+		{
+			T.addEntrant(spec.name, spec.code, spec.firstMove);
+		}
+
+		T.setErrorRate(T.getNumOfEntrants() - 1, spec.noise);
+	}
+
+	if (T.getNumOfEntrants() < 2)
+	{
+		cerr << "Error: A tournament needs at least 2 entrants" << endl;
+		return false;
+	}
+
+	T.setNumberOfRounds(config.numOfRounds);
+	T.setNumberOfThreads(getNumOfThreads(config));
+	T.setSeed(config.seed);
+	T.setSpecializedKernels(config.specialized);
+	T.setOutcomeCache(config.outcomes);
+	return true;
+}
+
+//Run a round-robin tournament between the configured and generated entrants
+int runTournament(const BatchConfig& config)
+{
+	Tournament T;
+
+	if (!buildTournament(config, T))
+	{
+		return 1;
+	}
+
+	int threads = getNumOfThreads(config);
+	string error;
+
+	if (!config.resumePath.empty() && !T.resume(config.resumePath, error))
+	{
+		cerr << "Error: " << error << endl;
+		return 1;
+	}
+
+	//A resumed run keeps saving to the checkpoint it came from unless told otherwise
+	string checkpointPath = config.checkpointPath.empty() ? config.resumePath : config.checkpointPath;
+
+	if (!checkpointPath.empty())
+	{
+		T.setCheckpoint(checkpointPath, config.checkpointInterval);
+	}
+
+	auto start = chrono::steady_clock::now();
+	T.run();
+	auto end = chrono::steady_clock::now();
+	double seconds = chrono::duration<double>(end - start).count();
+
+	T.displayRanking(cout, config.top);
+	cout << "seed=" << config.seed << " threads=" << threads << " elapsed_ms=" << seconds * 1000.0
+		<< " matches_per_s=" << (seconds > 0 ? T.getNumOfMatches() / seconds : 0)
+		<< " rounds_per_s=" << (seconds > 0 ? T.getNumOfMatches() * (double)config.numOfRounds / seconds : 0) << endl;
+
+	if (!checkpointPath.empty())
+	{
+		cout << "checkpoints=" << T.getNumOfCheckpoints() << " resumed_pairings=" << T.getNumOfResumedPairings() << endl;
+	}
+
+	if (!T.getCheckpointError().empty())
+	{
+		cerr << "Warning: " << T.getCheckpointError() << endl;
+	}
+
+	return 0;
+}
+
+//Worker process of a sharded tournament. It announces the fingerprint of its configuration, then
+//answers every "shard BEGIN END" line on stdin with "scores BEGIN END S0 S1 ..." on stdout until
+//stdin closes. With a cache it then sends every outcome it holds as "outcome KEY CHECK A B" and
+//its lookups as "lookups HITS MISSES", for the coordinator to merge and save.
+//Only lines of text cross, so a socket to another machine could carry them as well.
+int runShardWorker(const BatchConfig& config)
+{
+	Tournament T;
+
+	if (!buildTournament(config, T))
+	{
+		return 1;
+	}
+
+	cout << "hello " << T.getFingerprint() << ' ' << T.getNumOfPairings() << endl;
+
+	string line;
+
+	while (getline(cin, line))
+	{
+		istringstream request(line);
+		string command;
+		long long begin = 0, end = 0;
+
+		if (!(request >> command >> begin >> end) || command != "shard")
+		{
+			cerr << "Error: Unexpected request '" << line << "'" << endl;
+			return 1;
+		}
+
+		vector<long long> partial = T.runShard(begin, end);
+		string reply = "scores " + to_string(begin) + ' ' + to_string(end);
+
+		for (long long score : partial)
+		{
+			reply += ' ';
+			reply += to_string(score);
+		}
+
+		cout << reply << endl;
+	}
+
+	if (config.outcomes)
+	{
+		for (const OutcomeEntry& entry : config.outcomes->getEntries())
+		{
+			cout << "outcome " << entry.key << ' ' << entry.check << ' ' << entry.scoreA << ' ' << entry.scoreB << '\n';
+		}
+
+		cout << "lookups " << config.outcomes->getNumOfHits() << ' ' << config.outcomes->getNumOfMisses() << endl;
+	}
+
+	return 0;
+}
+
+#ifndef _WIN32
+//A worker process as the coordinator sees it
+struct ShardWorker
+{
+	pid_t pid = -1;
+	int requests = -1;  //Write end of the worker's stdin
+	int replies = -1;   //Read end of the worker's stdout
+	string pending;     //Reply bytes not yet forming a whole line
+	bool ready = false; //Announced the same configuration as the coordinator
+	long long begin = -1, end = -1; //Shard being played, begin = -1 when idle
+};
+
+//Start a copy of this program reading requests from one pipe and replying through another
+bool startShardWorker(const vector<string>& arguments, ShardWorker& worker)
+{
+	int requests[2], replies[2];
+
+	if (pipe(requests) != 0)
+	{
+		return false;
+	}
+
+	if (pipe(replies) != 0)
+	{
+		close(requests[0]);
+		close(requests[1]);
+		return false;
+	}
+
+	//Later workers must not inherit these ends, or a worker would never see its stdin close
+	for (int descriptor : { requests[0], requests[1], replies[0], replies[1] })
+	{
+		fcntl(descriptor, F_SETFD, FD_CLOEXEC);
+	}
+
+	vector<char*> args;
+	for (const string& argument : arguments)
+	{
+		args.push_back((char*)argument.c_str());
+	}
+	args.push_back(nullptr);
+
+	pid_t pid = fork();
+
+	if (pid == 0)
+	{
+		dup2(requests[0], STDIN_FILENO);
+		dup2(replies[1], STDOUT_FILENO);
+
+		//Prefer the very executable that is running over a search of the PATH
+		execv("/proc/self/exe", args.data());
+		execvp(args[0], args.data());
+		_exit(127);
+	}
+
+	close(requests[0]);
+	close(replies[1]);
+
+	if (pid < 0)
+	{
+		close(requests[1]);
+		close(replies[0]);
+		return false;
+	}
+
+	worker.pid = pid;
+	worker.requests = requests[1];
+	worker.replies = replies[0];
+	return true;
+}
+
+//Write a whole line to a worker; false if it has gone
+bool sendLine(int descriptor, const string& line)
+{
+	size_t done = 0;
+
+	while (done < line.size())
+	{
+		ssize_t written = write(descriptor, line.data() + done, line.size() - done);
+		if (written <= 0)
+		{
+			return false;
+		}
+
+		done += (size_t)written;
+	}
+
+	return true;
+}
+
+//Read a finished worker's remaining replies and merge the outcomes and lookups of its cache
+void collectOutcomes(ShardWorker& worker, OutcomeCache& outcomes)
+{
+	char buffer[65536];
+	ssize_t bytes;
+
+	while ((bytes = read(worker.replies, buffer, sizeof(buffer))) > 0)
+	{
+		worker.pending.append(buffer, (size_t)bytes);
+	}
+
+	istringstream replies(worker.pending);
+	worker.pending.clear();
+	string line;
+
+	while (getline(replies, line))
+	{
+		istringstream reply(line);
+		string kind;
+		reply >> kind;
+
+		if (kind == "outcome")
+		{
+			OutcomeEntry entry;
+
+			if (reply >> entry.key >> entry.check >> entry.scoreA >> entry.scoreB)
+			{
+				outcomes.insert(entry);
+			}
+		}
+		else if (kind == "lookups")
+		{
+			long long hits = 0, misses = 0;
+
+			if (reply >> hits >> misses)
+			{
+				outcomes.addLookups(hits, misses);
+			}
+		}
+	}
+}
+#endif
+
+//Split a tournament's pairings into shards, play them in worker processes started from this
+//program and merge the partial scores. Shards are handed out as workers become free, and the
+//shard of a worker that dies is given to another, so the ranking equals a single-process run.
+int runShardedTournament(const BatchConfig& config)
+{
+#ifdef _WIN32
+	cerr << "Error: --workers needs fork and exec, which this platform does not provide" << endl;
+	return 1;
+#else
+	Tournament T;
+
+	if (!buildTournament(config, T))
+	{
+		return 1;
+	}
+
+	//Enough shards to even out the workers, few enough that the messages cost nothing
+	long long pairings = T.getNumOfPairings();
+	long long shardSize = max(64LL, pairings / (16LL * config.workers));
+	deque<pair<long long, long long>> shards;
+
+	for (long long begin = 0; begin < pairings; begin += shardSize)
+	{
+		shards.emplace_back(begin, min(begin + shardSize, pairings));
+	}
+
+	//Workers rerun the same command line as workers, with the seed fixed so they all agree
+	vector<string> arguments = config.arguments;
+	arguments.insert(arguments.end(), { "--workers", "0", "--shard-worker", "--seed", to_string(config.seed) });
+
+	//Without --threads each worker takes one thread, the processes providing the parallelism
+	if (config.numOfThreads == 0)
+	{
+		arguments.insert(arguments.end(), { "--threads", "1" });
+	}
+
+	//A worker dying must show up as a failed write, not kill the coordinator
+	signal(SIGPIPE, SIG_IGN);
+
+	auto start = chrono::steady_clock::now();
+	vector<ShardWorker> workers(config.workers);
+
+	for (ShardWorker& worker : workers)
+	{
+		if (!startShardWorker(arguments, worker))
+		{
+			cerr << "Error: Cannot start a worker process" << endl;
+			return 1;
+		}
+	}
+
+	T.clearScores();
+	long long remaining = (long long)shards.size();
+	string error;
+
+	//Give a worker's shard back to the queue and stop using it
+	auto retire = [&shards](ShardWorker& worker)
+	{
+		if (worker.begin >= 0)
+		{
+			shards.emplace_front(worker.begin, worker.end);
+		}
+
+		close(worker.requests);
+		close(worker.replies);
+		worker.requests = worker.replies = -1;
+		worker.begin = -1;
+	};
+
+	while (remaining > 0 && error.empty())
+	{
+		vector<pollfd> watched;
+		vector<ShardWorker*> owners;
+
+		for (ShardWorker& worker : workers)
+		{
+			if (worker.replies < 0)
+			{
+				continue;
+			}
+
+			if (worker.ready && worker.begin < 0 && !shards.empty())
+			{
+				worker.begin = shards.front().first;
+				worker.end = shards.front().second;
+				shards.pop_front();
+
+				if (!sendLine(worker.requests, "shard " + to_string(worker.begin) + ' ' + to_string(worker.end) + '\n'))
+				{
+					retire(worker);
+					continue;
+				}
+			}
+
+			watched.push_back({ worker.replies, POLLIN, 0 });
+			owners.push_back(&worker);
+		}
+
+		if (watched.empty())
 		{
+			error = "Every worker process failed";
+			break;
+		}
+
+		if (poll(watched.data(), watched.size(), -1) < 0)
+		{
+			continue;
+		}
+
+		for (size_t k = 0; k < watched.size() && error.empty(); k++)
+		{
+			if (watched[k].revents == 0)
+			{
+				continue;
+			}
+
+			ShardWorker& worker = *owners[k];
+			char buffer[65536];
+			ssize_t bytes = read(worker.replies, buffer, sizeof(buffer));
+
+			if (bytes <= 0)
+			{
+				cerr << "Warning: Worker process " << worker.pid << " stopped; its shard goes to another" << endl;
+				retire(worker);
+				continue;
+			}
+
+			worker.pending.append(buffer, (size_t)bytes);
+			size_t newline;
+
+			while (error.empty() && (newline = worker.pending.find('\n')) != string::npos)
+			{
+				istringstream reply(worker.pending.substr(0, newline));
+				worker.pending.erase(0, newline + 1);
+				string kind;
+				reply >> kind;
+
+				if (kind == "hello")
+				{
+					uint64_t fingerprint = 0;
+					long long workerPairings = 0;
+					reply >> fingerprint >> workerPairings;
+
+					if (fingerprint != T.getFingerprint() || workerPairings != pairings)
+					{
+						error = "A worker process built a different tournament";
+					}
+
+					worker.ready = true;
+					continue;
+				}
+
+				long long begin = -1, end = -1;
+				vector<long long> partial(T.getNumOfEntrants());
+				reply >> begin >> end;
+
+				for (long long& score : partial)
+				{
+					reply >> score;
+				}
+
+				if (kind != "scores" || !reply || begin != worker.begin || end != worker.end)
+				{
+					error = "A worker process sent a malformed reply";
+					break;
+				}
+
+				T.addShardScores(partial);
+				worker.begin = -1;
+				remaining--;
+			}
+		}
+	}
+
+	//Closing their stdin tells the workers to finish; those with a cache then send its outcomes,
+	//which are merged here so that only this process writes the cache file
+	for (ShardWorker& worker : workers)
+	{
+		if (worker.replies >= 0)
+		{
+			close(worker.requests);
+			worker.requests = -1;
+
+			if (error.empty() && config.outcomes)
+			{
+				collectOutcomes(worker, *config.outcomes);
+			}
+
+			retire(worker);
+		}
+
+		waitpid(worker.pid, nullptr, 0);
+	}
+
+	if (!error.empty())
+	{
+		cerr << "Error: " << error << endl;
+		return 1;
+	}
+
+	auto end = chrono::steady_clock::now();
+	double seconds = chrono::duration<double>(end - start).count();
+
+	T.displayRanking(cout, config.top);
+	cout << "seed=" << config.seed << " workers=" << config.workers << " shards=" << (pairings + shardSize - 1) / shardSize
+		<< " elapsed_ms=" << seconds * 1000.0
+		<< " matches_per_s=" << (seconds > 0 ? T.getNumOfMatches() / seconds : 0)
+		<< " rounds_per_s=" << (seconds > 0 ? T.getNumOfMatches() * (double)config.numOfRounds / seconds : 0) << endl;
+
+	return 0;
+#endif
+}
+
+//Evolve a population of the configured strategy types and print how their shares develop
+int runEvolution(const BatchConfig& config)
+{
+	vector<StrategySpec> types;
+
+	if (!resolveEntrants(config, types))
+	{
+		return 1;
+	}
+
+	if (types.size() < 2 || types.size() > 65535)
+	{
+		cerr << "Error: Evolution needs between 2 and 65535 strategy types" << endl;
+		return 1;
+	}
+
+	if (config.populationSize < 2)
+	{
+		cerr << "Error: The population needs at least 2 agents" << endl;
+		return 1;
+	}
+
+	Population P;
+	int threads = getNumOfThreads(config);
+
+	for (const StrategySpec& spec : types)
+	{
+		P.addType(spec);
+	}
+
+	P.setNumberOfRounds(config.numOfRounds);
+	P.setSamples(config.samples);
+	P.setNumberOfThreads(threads);
+	P.setSeed(config.seed);
+	P.setSelection(config.selection);
+	P.setMutation(config.mutation);
+	P.setOutcomeCache(config.outcomes);
+
+	auto start = chrono::steady_clock::now();
+	P.computePayoffs();
+	auto payoffsDone = chrono::steady_clock::now();
+
+	P.initialize(config.populationSize);
+
+	for (long long g = 1; g <= config.generations; g++)
+	{
+		P.step(config.moran);
+
+		if (config.report > 0 && g % config.report == 0 && g != config.generations)
+		{
+			P.display(cout, g);
+		}
+	}
+
+	auto end = chrono::steady_clock::now();
+	double payoffSeconds = chrono::duration<double>(payoffsDone - start).count();
+	double evolveSeconds = chrono::duration<double>(end - payoffsDone).count();
+
+	P.display(cout, config.generations);
+	cout << "seed=" << config.seed << " threads=" << threads << " dynamics=" << (config.moran ? "moran" : "replicator")
+		<< " payoff_ms=" << payoffSeconds * 1000.0 << " evolve_ms=" << evolveSeconds * 1000.0 << endl;
+
+	return 0;
+}
+
+//Run the spatial game on the lattice and report type counts and cell-update throughput
+int runLattice(const BatchConfig& config)
+{
+	vector<StrategySpec> types;
+
+	if (!resolveEntrants(config, types))
+	{
+		return 1;
+	}
+
+	if (types.size() < 2 || types.size() > 256)
+	{
+		cerr << "Error: The lattice needs between 2 and 256 strategy types" << endl;
+		return 1;
+	}
+
+	if (config.latticeSize < 3)
+	{
+		cerr << "Error: The lattice must be at least 3 x 3" << endl;
+		return 1;
+	}
+
+	Lattice L;
+	int threads = getNumOfThreads(config);
 
-			case 1:
-			{
-				//Option 1: Add/Drop Players
+	for (const StrategySpec& spec : types)
+	{
+		L.addType(spec);
+	}
 
-				cout << endl;
-				cout << "1. Add New Players to the Game (Begin/Reset Game)" << endl;
-				cout << "2. Add Players to the Existing Game" << endl;
-				cout << "3. Drop Players" << endl;
-				cout << "Enter your choice (1-3): ";
-				cin >> choice2;
+	L.setNumberOfRounds(config.numOfRounds);
+	L.setSamples(config.samples);
+	L.setNumberOfThreads(threads);
+	L.setSeed(config.seed);
+	L.setNeighbours(config.neighbours);
+	L.setOutcomeCache(config.outcomes);
+	L.initialize(config.latticeSize);
 
-				while (isInvalidInput() || (choice2 != 1 && choice2 != 2 && choice2 != 3))
-				{
-					cout << "Invalid Choice! Please enter either 1,2 or 3: ";
-					cin >> choice2;
-				}
+	vector<long long> counts;
+	auto start = chrono::steady_clock::now();
 
+	for (long long g = 1; g <= config.generations; g++)
+	{
+		counts = L.step();
 
-				if (choice2 == 1)
-				{
-					//Add Players
-					cout << "Enter the number of players (exactly 2 players required): " << endl;
-					cin >> numOfPlayers; 
+		if (config.report > 0 && g % config.report == 0 && g != config.generations)
+		{
+			L.display(cout, g, counts);
+		}
+	}
 
-					while (isInvalidInput() || numOfPlayers != Max_Players)
-					{
-						cout << "Error! Please enter exactly 2 players: ";
-						cin >> numOfPlayers;
-					}
+	auto end = chrono::steady_clock::now();
+	double seconds = chrono::duration<double>(end - start).count();
+	double updates = (double)L.getNumOfCells() * (double)config.generations;
 
-					//Number of players can be increased by modifying the condition of the while loop
+	L.display(cout, config.generations, counts);
+	cout << "seed=" << config.seed << " threads=" << threads << " cells=" << L.getNumOfCells()
+		<< " elapsed_ms=" << seconds * 1000.0
+		<< " cell_updates_per_s=" << (seconds > 0 ? updates / seconds : 0) << endl;
 
-					//Add new players to the game
-					G.addPlayers(numOfPlayers);
-					playersCreated = true;
-				}
+	return 0;
+}
 
-				
-				else if (choice2 == 2)
-				{
-					if (!playersCreated)
-					{
-						cout << "Error: Create the players first (Option 1)!" << endl;
-						break;
-					}
+//Evolve memory-n strategies against the configured players and print per-generation stats
+int runSearch(const BatchConfig& config)
+{
+	vector<StrategySpec> references;
 
-					
-					if (numOfPlayers == Max_Players)
-					{
-						cout << "Error! Max Limit Reached! Could not add new players";
-						break;
-					}
+	if (!resolveEntrants(config, references))
+	{
+		return 1;
+	}
 
-					bool maxReached = false;
+	if (references.empty())
+	{
+		cerr << "Error: The search needs at least one reference strategy" << endl;
+		return 1;
+	}
 
+	if (config.memory < 1 || config.memory > 4)
+	{
+		cerr << "Error: Memory must be between 1 and 4" << endl;
+		return 1;
+	}
 
-					cout << "Enter the number of players to add to the game" << endl;
-					cin >> addPlayers;
+	if (config.populationSize < 2)
+	{
+		cerr << "Error: The population needs at least 2 genomes" << endl;
+		return 1;
+	}
 
-					while (isInvalidInput() || addPlayers < 1 || (numOfPlayers + addPlayers) > 2)
-					{
-						if (addPlayers < 1)
-						{
-							cout << "Please enter at least one player to add: " << endl;
-							cin >> addPlayers;
-						}
+	GeneticSearch S;
+	int threads = getNumOfThreads(config);
 
-						else if ((numOfPlayers + addPlayers) > 2)
-						{
-							//For the context of this assignment, the number of players has to be 2
-							cout << "Please enter a maximum of 2 players to start the game(enter exactly 2 players): ";
-							cin >> addPlayers;
-							maxReached = true;
-							break;
+	for (const StrategySpec& spec : references)
+	{
+		S.addReference(spec);
+	}
 
-						}
-					}
+	S.setMemory(config.memory);
+	S.setNumberOfRounds(config.numOfRounds);
+	S.setSamples(config.samples);
+	S.setNumberOfThreads(threads);
+	S.setMutation(config.mutation);
+	S.setErrorRate(config.noise);
+	S.setSeed(config.seed);
 
-					if (!maxReached) //Executes if and only if number of players is within the allowed limit
-					{
-						//Add additional players to the game
-						G.addPlayersToExistingGame(addPlayers);
+	auto start = chrono::steady_clock::now();
+	S.initialize(config.populationSize);
+	S.displayStats(cout);
 
-						numOfPlayers += addPlayers;
-					}
+	for (long long g = 1; g <= config.searchGenerations; g++)
+	{
+		S.step();
+		S.displayStats(cout);
+	}
 
-					else
-					{
-						continue;
-					}
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
 
-					break;
-				}
+	S.displayBest(cout);
+	cout << "seed=" << config.seed << " threads=" << threads << " cached_genomes=" << S.getNumOfCachedGenomes()
+		<< " elapsed_ms=" << seconds * 1000.0 << endl;
 
+	return 0;
+}
 
-				else if (choice2 == 3)
-				{
-					//Drop Players
-					if (!playersCreated)
-					{
-						cout << "Error: Create the players first (Option 1)!" << endl;
-						break;
-					}
+//Play the single configured pairing many times with the bit-sliced engine and report score statistics
+int runMonteCarlo(const BatchConfig& config)
+{
+	if ((int)config.names.size() != Max_Players)
+	{
+		cerr << "Error: Monte Carlo mode needs exactly " << Max_Players << " players" << endl;
+		return 1;
+	}
 
-					int pID;
+	MatchConfig pairing;
+	pairing.strategyA = config.strategies[0];
+	pairing.strategyB = config.strategies[1];
+	pairing.firstMoveA = config.firstMoves[0];
+	pairing.firstMoveB = config.firstMoves[1];
+	pairing.rounds = config.numOfRounds;
+	pairing.seed = config.seed;
+	pairing.idA = 1;
+	pairing.idB = 2;
+	pairing.noiseA = errorRateOf(config, config.names[0]);
+	pairing.noiseB = errorRateOf(config, config.names[1]);
+
+	BitSlicedBatch engine;
+
+	auto start = chrono::steady_clock::now();
+	BatchResult batch = engine.run(pairing, config.numOfRepeats);
+	auto end = chrono::steady_clock::now();
+	double seconds = chrono::duration<double>(end - start).count();
+
+	//Mean and standard deviation of each player's score over the matches
+	double n = (double)config.numOfRepeats;
+	double meanA = batch.totalA / n, meanB = batch.totalB / n;
+	double varA = 0, varB = 0;
+
+	for (const MatchResult& match : batch.matches)
+	{
+		varA += (match.scoreA - meanA) * (match.scoreA - meanA);
+		varB += (match.scoreB - meanB) * (match.scoreB - meanB);
+	}
 
-					cout << "Enter the ID of the player you want to drop: " << endl;
-					cin >> pID;
+	cout << "matches=" << config.numOfRepeats << " rounds=" << config.numOfRounds << '\n';
+	cout << "name=" << config.names[0] << " strategy=" << pairing.strategyA << " mean=" << meanA
+		<< " stddev=" << sqrt(varA / n) << '\n';
+	cout << "name=" << config.names[1] << " strategy=" << pairing.strategyB << " mean=" << meanB
+		<< " stddev=" << sqrt(varB / n) << '\n';
+	cout << "seed=" << config.seed << " elapsed_ms=" << seconds * 1000.0
+		<< " matches_per_s=" << (seconds > 0 ? n / seconds : 0)
+		<< " rounds_per_s=" << (seconds > 0 ? n * config.numOfRounds / seconds : 0) << endl;
 
-					while (isInvalidInput() || pID < 0)
-					{
-						cout << "Please enter a non-negative integer value for ID: ";
-						cin >> pID;
-					}
+	if (config.verify)
+	{
+		//Every lane must match the scalar round-by-round engine exactly
+		long long mismatches = 0;
+		long long sumA = 0, sumB = 0;
 
-					//Drop the specified player
-					G.dropPlayer(pID);
-					numOfPlayers--;
-				}
+		for (long long m = 0; m < config.numOfRepeats; m++)
+		{
+			sumA += batch.matches[(size_t)m].scoreA;
+			sumB += batch.matches[(size_t)m].scoreB;
 
-				break;
+			MatchConfig scalar = pairing;
+			scalar.matchID = pairing.matchID + (uint64_t)m;
+			MatchResult expected = playMatchGeneric(scalar);
+
+			if (expected.scoreA != batch.matches[(size_t)m].scoreA || expected.scoreB != batch.matches[(size_t)m].scoreB)
+			{
+				mismatches++;
 			}
+		}
 
-			case 2:
+		//The popcount totals must agree with the per-lane scores
+		if (sumA != batch.totalA || sumB != batch.totalB)
+		{
+			mismatches++;
+		}
+
+		cout << "verify=" << (mismatches == 0 ? "ok" : "FAILED") << " mismatches=" << mismatches << endl;
+		return mismatches == 0 ? 0 : 1;
+	}
+
+	return 0;
+}
+
+//Repeat a pairing or a tournament until the mean score of every player is known to the
+//requested precision, printing the means with their confidence intervals
+int runReplicates(const BatchConfig& config)
+{
+	if (!(config.ciWidth > 0) || !(config.confidence > 0 && config.confidence < 1) || config.maxReplicates < 2)
+	{
+		cerr << "Error: Replicates need a positive --ci-width, a confidence between 0 and 1 and at least 2 replicates" << endl;
+		return 1;
+	}
+
+	ReplicateRunner R;
+	Tournament T;
+	int threads = getNumOfThreads(config);
+
+	if (config.tournament)
+	{
+		if (!buildTournament(config, T))
+		{
+			return 1;
+		}
+
+		R.setTournament(T);
+	}
+	else
+	{
+		vector<StrategySpec> players;
+
+		if (!resolveEntrants(config, players))
+		{
+			return 1;
+		}
+
+		if ((int)players.size() != Max_Players)
+		{
+			cerr << "Error: Repeating a pairing needs exactly " << Max_Players << " players" << endl;
+			return 1;
+		}
+
+		//Same sides as the Monte Carlo mode: player 1 is side A
+		MatchConfig pairing;
+		setMatchStrategies(pairing, players[0], players[1]);
+		pairing.rounds = config.numOfRounds;
+		pairing.idA = 1;
+		pairing.idB = 2;
+
+		R.setPairing(pairing, players[0].name, players[1].name);
+	}
+
+	R.setTargetWidth(config.ciWidth);
+	R.setConfidence(config.confidence);
+	R.setReplicateLimits(config.minReplicates, config.maxReplicates);
+	R.setNumberOfThreads(threads);
+	R.setSeed(config.seed);
+
+	auto start = chrono::steady_clock::now();
+	R.run();
+	auto end = chrono::steady_clock::now();
+	double seconds = chrono::duration<double>(end - start).count();
+
+	R.displayResult(cout, config.tournament ? config.top : Max_Players);
+	cout << "seed=" << config.seed << " threads=" << threads << " elapsed_ms=" << seconds * 1000.0
+		<< " replicates_per_s=" << (seconds > 0 ? R.getNumOfReplicates() / seconds : 0) << endl;
+
+	return 0;
+}
+
+//Expected scores of a tournament from the Markov chains of its pairings, ranked like a played one
+int runAnalyticTournament(const BatchConfig& config, const vector<StrategySpec>& entrants)
+{
+	size_t n = entrants.size();
+	vector<double> expected(n, 0.0);
+	bool symmetric = payoffs.isSymmetric();
+
+	if (n < 2)
+	{
+		cerr << "Error: A tournament needs at least 2 entrants" << endl;
+		return 1;
+	}
+
+	for (size_t i = 0; i < n; i++)
+	{
+		for (size_t j = i + 1; j < n; j++)
+		{
+			//Under asymmetric payoffs each pair also meets with the roles swapped, as in Tournament::run
+			for (int order = 0; order < (symmetric ? 1 : 2); order++)
 			{
-				//Option 2: Set Number of Rounds
+				size_t a = order ? j : i, b = order ? i : j;
+				MatchConfig pairing;
+				setMatchStrategies(pairing, entrants[a], entrants[b]);
 
-				//Ensure players are created before setting the number of rounds
-				if (!playersCreated)
+				MarkovMatch chain;
+				string error;
+
+				if (!chain.build(pairing, error))
 				{
-					cout << "Error: Create the players first (Option 1)!" << endl;
-					break;
+					cerr << "Error: No analytic result for " << entrants[a].name << " against " << entrants[b].name << ": " << error << endl;
+					return 1;
 				}
 
-				bool flag = true;
+				ExpectedScores scores = chain.expected(config.numOfRounds);
+				expected[a] += scores.scoreA;
+				expected[b] += scores.scoreB;
+			}
+		}
+	}
 
+	vector<size_t> order(n);
+	for (size_t i = 0; i < n; i++)
+	{
+		order[i] = i;
+	}
 
-				if (!flag)
-				{
-					for (int i = 0; i < numOfPlayers; i++)
-					{
-						//Deallocate memory for the player's previous moves
-						delete[] G.getPlayerInfo()[i].resetMoves();
+	stable_sort(order.begin(), order.end(), [&expected](size_t x, size_t y) { return expected[x] > expected[y]; });
 
-					}
+	cout << "entrants=" << n << " rounds=" << config.numOfRounds << '\n';
 
-					flag = true;
+	for (size_t r = 0; r < n && (int)r < config.top; r++)
+	{
+		size_t i = order[r];
+		cout << "rank=" << r + 1 << " id=" << i + 1 << " name=" << entrants[i].name
+			<< " strategy=" << (entrants[i].table ? entrants[i].table->getName() : string(1, entrants[i].code))
+			<< " expected=" << expected[i] << '\n';
+	}
 
-				}
+	return 0;
+}
+
+//Exact expected scores of a pairing (or every pairing of a tournament) from its Markov chain;
+//with --verify the pairing is also simulated and the sample mean compared with the expectation
+int runAnalytic(const BatchConfig& config)
+{
+	vector<StrategySpec> players;
+
+	if (!resolveEntrants(config, players))
+	{
+		return 1;
+	}
+
+	if (config.discount != -1 && !(config.discount >= 0 && config.discount < 1))
+	{
+		cerr << "Error: The discount must be at least 0 and below 1" << endl;
+		return 1;
+	}
+
+	auto start = chrono::steady_clock::now();
+
+	if (config.tournament)
+	{
+		int status = runAnalyticTournament(config, players);
+		double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+		if (status == 0)
+		{
+			cout << "elapsed_ms=" << seconds * 1000.0 << endl;
+		}
+
+		return status;
+	}
+
+	if ((int)players.size() != Max_Players)
+	{
+		cerr << "Error: The analytic mode needs exactly " << Max_Players << " players, or --tournament" << endl;
+		return 1;
+	}
+
+	//Same sides as the Monte Carlo mode: player 1 is side A
+	MatchConfig pairing;
+	setMatchStrategies(pairing, players[0], players[1]);
+	pairing.rounds = config.numOfRounds;
+	pairing.seed = config.seed;
+	pairing.idA = 1;
+	pairing.idB = 2;
+
+	MarkovMatch chain;
+	string error;
+
+	if (!chain.build(pairing, error))
+	{
+		cerr << "Error: No analytic result: " << error << endl;
+		return 1;
+	}
+
+	ExpectedScores total = chain.expected(config.numOfRounds);
+	ExpectedScores limit = chain.longRun();
+	ExpectedScores discounted = (config.discount >= 0) ? chain.discounted(config.discount) : ExpectedScores();
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	cout << "rounds=" << config.numOfRounds << " states=" << chain.getNumOfStates() << '\n';
+
+	for (int side = 0; side < 2; side++)
+	{
+		const StrategySpec& spec = players[side];
+		cout << "name=" << spec.name << " strategy=" << (spec.table ? spec.table->getName() : string(1, spec.code))
+			<< " expected=" << (side ? total.scoreB : total.scoreA)
+			<< " per_round=" << (side ? total.scoreB : total.scoreA) / (double)config.numOfRounds
+			<< " long_run=" << (side ? limit.scoreB : limit.scoreA);
+
+		if (config.discount >= 0)
+		{
+			cout << " discounted=" << (side ? discounted.scoreB : discounted.scoreA);
+		}
+
+		cout << '\n';
+	}
+
+	cout << "elapsed_ms=" << seconds * 1000.0 << endl;
+
+	if (!config.verify)
+	{
+		return 0;
+	}
+
+	//Simulate the pairing and check that the sample means lie within a few standard errors
+	long long matches = (config.numOfRepeats > 0) ? config.numOfRepeats : 1000;
+	RunningStats simulated[2];
+
+	for (long long m = 0; m < matches; m++)
+	{
+		MatchConfig match = pairing;
+		match.matchID = (uint64_t)m;
+
+		MatchResult result = playMatch(match);
+		simulated[0].add((double)result.scoreA);
+		simulated[1].add((double)result.scoreB);
+	}
+
+	bool ok = true;
+
+	for (int side = 0; side < 2; side++)
+	{
+		double expected = side ? total.scoreB : total.scoreA;
+		double error = sqrt(simulated[side].variance() / (double)matches);
+		double z = (error > 0) ? (simulated[side].mean - expected) / error : 0.0;
+
+		//A match without randomness must hit the expectation up to rounding
+		bool agrees = (error > 0) ? fabs(z) < 5 : fabs(simulated[side].mean - expected) <= 1e-6 * max(1.0, fabs(expected));
+		ok = ok && agrees;
+
+		cout << "name=" << players[side].name << " simulated_mean=" << simulated[side].mean
+			<< " standard_error=" << error << " z=" << z << '\n';
+	}
+
+	cout << "verify=" << (ok ? "ok" : "FAILED") << " matches=" << matches << endl;
+	return ok ? 0 : 1;
+}
+
+//Run the mode selected by a complete configuration
+int runMode(const BatchConfig& config)
+{
+	if ((!config.checkpointPath.empty() || !config.resumePath.empty() || config.workers != 0)
+		&& (!config.tournament || config.analytic || config.ciWidth != 0))
+	{
+		cerr << "Error: --checkpoint, --resume and --workers apply to plain tournaments (--tournament)" << endl;
+		return 1;
+	}
+
+	if (config.workers < 0 || (config.workers > 0 && (!config.checkpointPath.empty() || !config.resumePath.empty())))
+	{
+		cerr << "Error: --workers needs a positive count and cannot be combined with checkpoints" << endl;
+		return 1;
+	}
+
+	if (config.shardWorker)
+	{
+		return runShardWorker(config);
+	}
+
+	if (config.workers > 0)
+	{
+		return runShardedTournament(config);
+	}
+
+	if (config.analytic)
+	{
+		return runAnalytic(config);
+	}
 
-				cout << "Enter the number of rounds: ";
-				cin >> numOfRounds;
+	if (config.ciWidth != 0)
+	{
+		return runReplicates(config);
+	}
 
-				while (isInvalidInput() || numOfRounds <= 0)
-				{
-					cout << "Please enter a positive value for number of rounds: ";
-					cin >> numOfRounds;
-				}
+	if (config.tournament)
+	{
+		return runTournament(config);
+	}
 
-				//Set the number of rounds in the game
-				G.setNumberOfRounds(numOfRounds);
+	if (config.searchGenerations > 0)
+	{
+		return runSearch(config);
+	}
 
-				setNumberOfRounds = true;
-				flag = false;
-				break;
-			}
+	if (config.generations > 0 && config.latticeSize > 0)
+	{
+		return runLattice(config);
+	}
 
+	if (config.generations > 0)
+	{
+		return runEvolution(config);
+	}
 
-			case 3:
-			{
-				//Option 3: Choose your game strategy
+	for (size_t i = 0; i < config.tableNames.size(); i++)
+	{
+		if (!config.tableNames[i].empty())
+		{
+			cerr << "Error: Table strategy '" << config.tableNames[i] << "' can only be used in a tournament" << endl;
+			return 1;
+		}
+	}
 
-				//Ensure players and the number of rounds are set before choosing strategies.
-				if (!playersCreated || !setNumberOfRounds)
-				{
-					cout << "Error: Create the players, and set the number of rounds first (Options 1, and 2)!" << endl;
-					break;
-				}
+	if (config.numOfRepeats > 0)
+	{
+		return runMonteCarlo(config);
+	}
 
-				//Display available game strategies
-				cout << endl;
-				cout << "==================================" << endl;
-				cout << "          GAME STRATEGIES         " << endl;
-				cout << "==================================" << endl;
-				cout << "Enter r for Random" << endl;
-				cout << "Enter c for Cooperate" << endl;
-				cout << "Enter e for Evil" << endl;
-				cout << "Enter t for Tit for Tat" << endl;
-				cout << endl;
+	if (config.numOfRounds > numeric_limits<int>::max())
+	{
+		cerr << "Error: A single game supports at most " << numeric_limits<int>::max() << " rounds" << endl;
+		return 1;
+	}
 
+	if ((int)config.names.size() != Max_Players)
+	{
+		cerr << "Error: Exactly " << Max_Players << " players are required" << endl;
+		return 1;
+	}
 
-				//Prompt each player to choose a strategy
-				for (int i = 0; i < numOfPlayers; i++)
-				{
-					do
-					{
-						cout << "Player " << i + 1 << " , Please choose your strategy: ";
-						cin >> choice3;
+	Game G;
+	int numOfPlayers = (int)config.names.size();
 
-						if (choice3 != 'r' && choice3 != 'c' && choice3 != 'e' && choice3 != 't')
-						{
-							cout << "Please either 'r', 'c', 'e', or 't' for your strategy : " << endl;
-						}
+	G.createPlayers(numOfPlayers);
 
-						cin.clear();
-						cin.ignore(numeric_limits<streamsize>::max(), '\n');
+	for (int i = 0; i < numOfPlayers; i++)
+	{
+		G.getPlayerInfo()[i].setName(config.names[i]);
+		G.getPlayerInfo()[i].updateStrategy(config.strategies[i]);
+		G.getPlayerInfo()[i].setFirstMove(config.firstMoves[i]);
+		G.getPlayerInfo()[i].setErrorRate(errorRateOf(config, config.names[i]));
+	}
 
-					} while (isInvalidInput() || (choice3 != 'r' && choice3 != 'c' && choice3 != 'e' && choice3 != 't'));
+	G.setSeed(config.seed);
+	G.setNumberOfRounds((int)config.numOfRounds);
+	G.setUseKernels(config.specialized);
+	G.setOutcomeCache(config.outcomes);
 
-					//Set the chosen strategy for the player
-					G.getPlayerInfo()[i].updateStrategy(choice3);
+	//Verbose output is formatted here and written by the log's own thread
+	AsyncLog log;
 
-				}
+	if (!config.logPath.empty())
+	{
+		if (!log.open(config.logPath))
+		{
+			cerr << "Error: Cannot write log file '" << config.logPath << "'" << endl;
+			return 1;
+		}
+	}
+	else if (config.verbose)
+	{
+		log.openStdout();
+	}
 
-				setStrategy = true;
-				break;
-			}
+	AsyncLogStream logStream(log);
+	G.setLog(log.isOpen() ? &logStream : nullptr, config.logLevel);
 
-			case 4:
-			{
-				//Option 4: Start the game
+	//Side A of the trace is player 2, as in the match kernels
+	TraceWriter trace;
 
-				//Ensure players, the number of rounds, and strategies are set before starting the game.
-				if (!playersCreated || !setNumberOfRounds || !setStrategy)
-				{
-					cout << "Error: Create the players, set the number of rounds, and choose strategy first (Options 1, 2, and 3)!" << endl;
-					break;
-				}
+	if (!config.tracePath.empty())
+	{
+		if (!trace.open(config.tracePath, config.names[1], config.names[0], config.seed))
+		{
+			cerr << "Error: Cannot write trace file '" << config.tracePath << "'" << endl;
+			return 1;
+		}
 
-				//Start the game
-				G.play();
+		G.setTrace(&trace);
+	}
 
-				break;
-			}
+	auto start = chrono::steady_clock::now();
+	G.simulate();
+	auto end = chrono::steady_clock::now();
 
+	logStream.flush();
+	log.close();
 
-			case 5:
-			{
-				//Option 5: Exit
+	if (trace.isOpen() && !trace.close())
+	{
+		cerr << "Error: Writing trace file '" << config.tracePath << "' failed" << endl;
+		return 1;
+	}
 
-				cout << "Thank you for playing!" << endl;
+	G.displaySummary(cout);
+	cout << "seed=" << config.seed << " elapsed_ms=" << chrono::duration<double, milli>(end - start).count() << endl;
 
-				cout << endl;
+	return 0;
+}
 
-				cout << "End of the program!" << endl;
-				break;
-			}
+//Run a game from command-line arguments without any prompts, printing only a compact summary
+int runBatch(int argc, char* argv[])
+{
+	BatchConfig config;
+	config.arguments.assign(argv, argv + argc);
 
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		bool hasValue = (i + 1 < argc);
 
-			default:
+		if (arg == "--config" && hasValue)
+		{
+			if (!loadBatchConfig(config, argv[++i]))
 			{
-				//Handle invalid choices
-				cout << "Invalid Choice! Please enter either 1, 2, 3, 4, or 5. ";
-
-				//Clears the input buffer
-				cin.clear();
+				return 1;
+			}
+		}
+		else if (arg == "--rounds" && hasValue)
+		{
+			config.numOfRounds = atoll(argv[++i]);
+		}
+		else if (arg == "--tournament")
+		{
+			config.tournament = true;
+		}
+		else if (arg == "--threads" && hasValue)
+		{
+			config.numOfThreads = atoi(argv[++i]);
+		}
+		else if (arg == "--entrants" && hasValue)
+		{
+			config.numOfEntrants = atoi(argv[++i]);
+		}
+		else if (arg == "--top" && hasValue)
+		{
+			config.top = atoi(argv[++i]);
+		}
+		else if (arg == "--strategies" && hasValue)
+		{
+			config.strategyFiles.push_back(argv[++i]);
+		}
+		else if (arg == "--evolve" && hasValue)
+		{
+			config.generations = atoll(argv[++i]);
+		}
+		else if (arg == "--population" && hasValue)
+		{
+			config.populationSize = atoll(argv[++i]);
+		}
+		else if (arg == "--dynamics" && hasValue)
+		{
+			config.moran = (string(argv[++i]) != "replicator");
+		}
+		else if (arg == "--selection" && hasValue)
+		{
+			if (!parseRate("Selection", argv[++i], config.selection))
+			{
+				return 1;
+			}
+		}
+		else if (arg == "--mutation" && hasValue)
+		{
+			if (!parseRate("Mutation", argv[++i], config.mutation))
+			{
+				return 1;
+			}
+		}
+		else if (arg == "--samples" && hasValue)
+		{
+			config.samples = atoi(argv[++i]);
+		}
+		else if (arg == "--report" && hasValue)
+		{
+			config.report = atoll(argv[++i]);
+		}
+		else if (arg == "--lattice" && hasValue)
+		{
+			config.latticeSize = atoll(argv[++i]);
+		}
+		else if (arg == "--neighbours" && hasValue)
+		{
+			config.neighbours = atoi(argv[++i]);
+		}
+		else if (arg == "--search" && hasValue)
+		{
+			config.searchGenerations = atoll(argv[++i]);
+		}
+		else if (arg == "--memory" && hasValue)
+		{
+			config.memory = atoi(argv[++i]);
+		}
+		else if (arg == "--trace" && hasValue)
+		{
+			config.tracePath = argv[++i];
+		}
+		else if (arg == "--metrics" && hasValue)
+		{
+			config.metricsPath = argv[++i];
+		}
+		else if (arg == "--analytic")
+		{
+			config.analytic = true;
+		}
+		else if (arg == "--discount" && hasValue)
+		{
+			config.discount = atof(argv[++i]);
+		}
+		else if (arg == "--ci-width" && hasValue)
+		{
+			config.ciWidth = atof(argv[++i]);
+		}
+		else if (arg == "--confidence" && hasValue)
+		{
+			config.confidence = atof(argv[++i]);
+		}
+		else if (arg == "--replicates" && hasValue)
+		{
+			config.maxReplicates = atoll(argv[++i]);
+		}
+		else if (arg == "--min-replicates" && hasValue)
+		{
+			config.minReplicates = atoll(argv[++i]);
+		}
+		else if (arg == "--checkpoint" && hasValue)
+		{
+			config.checkpointPath = argv[++i];
+		}
+		else if (arg == "--checkpoint-every" && hasValue)
+		{
+			config.checkpointInterval = atof(argv[++i]);
+		}
+		else if (arg == "--resume" && hasValue)
+		{
+			config.resumePath = argv[++i];
+		}
+		else if (arg == "--workers" && hasValue)
+		{
+			config.workers = atoi(argv[++i]);
+		}
+		else if (arg == "--shard-worker")
+		{
+			config.shardWorker = true;
+		}
+		else if (arg == "--cache")
+		{
+			config.cache = true;
+		}
+		else if (arg == "--cache-file" && hasValue)
+		{
+			config.cache = true;
+			config.cachePath = argv[++i];
+		}
+		else if (arg == "--noise" && hasValue)
+		{
+			if (!addNoise(config, argv[++i]))
+			{
+				return 1;
+			}
+		}
+		else if ((arg == "--payoffs" || arg == "--payoff-file") && hasValue)
+		{
+			string error;
+			bool loaded = (arg == "--payoffs") ? PayoffMatrix::parse(argv[++i], config.payoffMatrix, error)
+				: PayoffMatrix::load(argv[++i], config.payoffMatrix, error);
 
-				//To ensure that error message is printed only once
-				cin.ignore(numeric_limits<streamsize>::max(), '\n');
-				continue;
+			if (!loaded)
+			{
+				cerr << "Error: " << error << endl;
+				return 1;
+			}
+		}
+		else if (arg == "--log" && hasValue)
+		{
+			config.logPath = argv[++i];
+		}
+		else if (arg == "--log-level" && hasValue)
+		{
+			config.logLevel = (string(argv[++i]) == "rounds") ? LogRounds : LogMoves;
+		}
+		else if (arg == "--montecarlo" && hasValue)
+		{
+			config.numOfRepeats = atoll(argv[++i]);
+		}
+		else if (arg == "--verify")
+		{
+			config.verify = true;
+		}
+		else if (arg == "--kernel" && hasValue)
+		{
+			config.specialized = (string(argv[++i]) != "generic");
+		}
+		else if (arg == "--seed" && hasValue)
+		{
+			config.seed = strtoull(argv[++i], nullptr, 10);
+			config.hasSeed = true;
+		}
+		else if (arg == "--player" && hasValue)
+		{
+			if (!addBatchPlayer(config, argv[++i]))
+			{
+				return 1;
 			}
 		}
+		else if (arg == "--verbose")
+		{
+			config.verbose = true;
+		}
+		else
+		{
+			printUsage(argv[0]);
+			return (arg == "--help" || arg == "-h") ? 0 : 1;
+		}
+	}
 
-	} while (choice1 != 5);
+	if (config.numOfRounds <= 0)
+	{
+		cerr << "Error: Number of rounds must be a positive value" << endl;
+		return 1;
+	}
 
-	return 0;
-}
+	//Without an explicit seed every run differs, as in the interactive game
+	if (!config.hasSeed)
+	{
+		config.seed = (uint64_t)time(NULL);
+	}
 
+	//The payoffs were validated when they were read
+	string error;
+	setPayoffs(config.payoffMatrix, error);
 
-//Function to check if the input is valid
-bool isInvalidInput()
-{
-	bool invalidInput = false;
+	//Matches are looked up in the outcome cache, which a file may carry from run to run
+	OutcomeCache outcomes;
 
-	//Check for invalid input
-	if (cin.fail())
+	if (config.cache)
 	{
-		invalidInput = true;
-		cout << "Error! Invalid Input! Please enter a valid numeric input!" << endl;
-		cout << endl;
+		if (!config.cachePath.empty() && !outcomes.load(config.cachePath, error))
+		{
+			cerr << "Error: " << error << endl;
+			return 1;
+		}
 
-		//Clears the input buffer
-		cin.clear();
+		config.outcomes = &outcomes;
+	}
 
-		//To ensure that error message is printed only once
-		cin.ignore(numeric_limits<streamsize>::max(), '\n');
+	int status = runMode(config);
+
+	//A shard worker sends its outcomes to the coordinator, which merges and saves those of every worker
+	if (config.cache && status == 0 && !config.shardWorker)
+	{
+		cout << "cache_hits=" << outcomes.getNumOfHits() << " cache_misses=" << outcomes.getNumOfMisses()
+			<< " cache_entries=" << outcomes.getNumOfEntries() << " cache_loaded=" << outcomes.getNumOfLoaded()
+			<< " cache_invalidated=" << (outcomes.wasInvalidated() ? 1 : 0) << endl;
 
+		if (!config.cachePath.empty() && !outcomes.save(config.cachePath, error))
+		{
+			cerr << "Error: " << error << endl;
+			return 1;
+		}
 	}
 
-	else
+#ifdef IPD_METRICS
+	//Instrumented builds report where the time went, to the metrics file or stderr
+	if (status != 0)
 	{
-		invalidInput = false;
+		return status;
 	}
 
-	return invalidInput;
+	if (config.metricsPath.empty())
+	{
+		Metrics::dump(cerr);
+	}
+	else if (!Metrics::dump(config.metricsPath))
+	{
+		cerr << "Error: Cannot write metrics file '" << config.metricsPath << "'" << endl;
+	}
+#else
+	if (!config.metricsPath.empty())
+	{
+		cerr << "Warning: Built without IPD_METRICS, so there are no metrics to write" << endl;
+	}
+#endif
+
+	return status;
 }
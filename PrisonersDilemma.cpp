@@ -0,0 +1,1084 @@
+/*---------------------------------------------------*/
+/* Program: PrisonersDilemma.cpp                     */
+/* Description: Out-of-line parts of the engine      */
+/* library: the payoffs, the match kernels and     */
+/* the static members of the engine classes.         */
+/*---------------------------------------------------*/
+
+#include "PrisonersDilemma.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ipd
+{
+
+//Initializing static member ID of generateID class
+int generateID::ID = 0;
+//Initializing static member numOfPlayers of Player class
+int Player::numOfPlayers = 0;
+
+//Payoffs every match is scored with, the usual ones unless replaced through setPayoffs
+PayoffMatrix payoffs = defaultPayoffs;
+
+//Replace the active payoffs after validating them
+bool setPayoffs(const PayoffMatrix& matrix, string& error)
+{
+	if (!matrix.validate(error))
+	{
+		return false;
+	}
+
+	payoffs = matrix;
+	return true;
+}
+
+//Score a player receives for their move against the opponent's move (same rules as Game::simulate)
+int getPayoff(int side, char move, char opponentMove)
+{
+	return payoffs.get(side, move == 'd', opponentMove == 'd');
+}
+
+
+//Fill in the strategies of both sides of a match
+void setMatchStrategies(MatchConfig& config, const StrategySpec& a, const StrategySpec& b)
+{
+	config.strategyA = a.code;
+	config.strategyB = b.code;
+	config.firstMoveA = a.firstMove;
+	config.firstMoveB = b.firstMove;
+	config.tableA = a.table.get();
+	config.tableB = b.table.get();
+	config.noiseA = a.noise;
+	config.noiseB = b.noise;
+}
+
+
+//Match loop shared by all table strategies. Each round is two table lookups for the moves and
+//two for the next states. Between deterministic tables the joint state (stateA, stateB) must
+//repeat within numOfStatesA * numOfStatesB rounds; when fastForward is set the remaining whole
+//cycles are then scored at once. Under noise every move may be flipped, so nothing repeats.
+MatchResult runTableKernel(const StrategyTable& a, const StrategyTable& b, const MatchConfig& config, bool fastForward)
+{
+	RandomStream randomA, randomB;
+	randomA.seed(config.seed, config.matchID, config.idA);
+	randomB.seed(config.seed, config.matchID, config.idB);
+
+	uint32_t stateA = a.getInitialState(), stateB = b.getInitialState();
+	long long scoreA = 0, scoreB = 0;
+	const int32_t* payoffA = payoffs.table[0];
+	const int32_t* payoffB = payoffs.table[1];
+	long long i = 0;
+
+	if (config.noiseA > 0 || config.noiseB > 0)
+	{
+		NoiseStream noiseA, noiseB;
+		noiseA.seed(config.noiseA, config.seed, config.matchID, config.idA);
+		noiseB.seed(config.noiseB, config.seed, config.matchID, config.idB);
+
+		for (; i < config.rounds; i++)
+		{
+			int moveA = a.move(stateA, randomA) ^ (int)noiseA.flip();
+			int moveB = b.move(stateB, randomB) ^ (int)noiseB.flip();
+
+			scoreA += payoffA[(moveA << 1) | moveB];
+			scoreB += payoffB[(moveB << 1) | moveA];
+
+			stateA = a.nextState(stateA, (moveA << 1) | moveB);
+			stateB = b.nextState(stateB, (moveB << 1) | moveA);
+		}
+
+		fastForward = false;
+	}
+
+	uint64_t jointStates = (uint64_t)a.getNumOfStates() * b.getNumOfStates();
+
+	if (fastForward && a.isDeterministic() && b.isDeterministic() && jointStates <= (1u << 20)
+		&& (long long)jointStates < config.rounds)
+	{
+		vector<long long> seenAt((size_t)jointStates, -1);
+		vector<long long> seenScoreA((size_t)jointStates), seenScoreB((size_t)jointStates);
+
+		for (; i < config.rounds; i++)
+		{
+			size_t joint = (size_t)stateA * b.getNumOfStates() + stateB;
+
+			if (seenAt[joint] >= 0)
+			{
+				long long length = i - seenAt[joint];
+				long long cycles = (config.rounds - i) / length;
+
+				scoreA += cycles * (scoreA - seenScoreA[joint]);
+				scoreB += cycles * (scoreB - seenScoreB[joint]);
+				i += cycles * length;
+				IPD_COUNT(CounterSkippedRounds, cycles * length);
+				break;
+			}
+
+			seenAt[joint] = i;
+			seenScoreA[joint] = scoreA;
+			seenScoreB[joint] = scoreB;
+
+			int moveA = a.move(stateA, randomA);
+			int moveB = b.move(stateB, randomB);
+
+			scoreA += payoffA[(moveA << 1) | moveB];
+			scoreB += payoffB[(moveB << 1) | moveA];
+
+			stateA = a.nextState(stateA, (moveA << 1) | moveB);
+			stateB = b.nextState(stateB, (moveB << 1) | moveA);
+		}
+	}
+
+	for (; i < config.rounds; i++)
+	{
+		int moveA = a.move(stateA, randomA);
+		int moveB = b.move(stateB, randomB);
+
+		scoreA += payoffA[(moveA << 1) | moveB];
+		scoreB += payoffB[(moveB << 1) | moveA];
+
+		stateA = a.nextState(stateA, (moveA << 1) | moveB);
+		stateB = b.nextState(stateB, (moveB << 1) | moveA);
+	}
+
+	MatchResult result;
+	result.scoreA = scoreA;
+	result.scoreB = scoreB;
+	return result;
+}
+
+//Run a match in which at least one side is a table strategy, converting a built-in side to its table
+MatchResult playTableMatch(const MatchConfig& config, bool fastForward)
+{
+	IPD_COUNT(CounterTableMatches, 1);
+	const StrategyTable* a = config.tableA ? config.tableA : StrategyLibrary::builtin(config.strategyA, config.firstMoveA);
+	const StrategyTable* b = config.tableB ? config.tableB : StrategyLibrary::builtin(config.strategyB, config.firstMoveB);
+
+	if (a == nullptr || b == nullptr)
+	{
+		return MatchResult(); //Invalid strategy code
+	}
+
+	return runTableKernel(*a, *b, config, fastForward);
+}
+
+
+//Play one match move by move through Strategy::cooperateOrDefect (or, for table strategies,
+//the table kernel without fast-forwarding).
+//This is the reference path the specialised kernels below must agree with.
+MatchResult playMatchGeneric(const MatchConfig& config)
+{
+	if (config.tableA != nullptr || config.tableB != nullptr)
+	{
+		return playTableMatch(config, false);
+	}
+
+	IPD_COUNT(CounterGenericMatches, 1);
+
+	MatchResult result;
+	Strategy a, b;
+	a.setStrategyCode(config.strategyA);
+	b.setStrategyCode(config.strategyB);
+	a.seedRandom(config.seed, config.matchID, config.idA);
+	b.seedRandom(config.seed, config.matchID, config.idB);
+
+	NoiseStream noiseA, noiseB;
+	noiseA.seed(config.noiseA, config.seed, config.matchID, config.idA);
+	noiseB.seed(config.noiseB, config.seed, config.matchID, config.idB);
+
+	//Before the first round tit for tat "copies" its own first move, as in Game::simulate
+	char opponentOfA = (config.strategyA == 't') ? config.firstMoveA : 'c';
+	char opponentOfB = (config.strategyB == 't') ? config.firstMoveB : 'c';
+
+	for (long long i = 0; i < config.rounds; i++)
+	{
+		char moveA = a.cooperateOrDefect(opponentOfA);
+		char moveB = b.cooperateOrDefect(opponentOfB);
+
+		//A flipped move is what the opponent sees and what is scored
+		if (noiseA.flip())
+		{
+			moveA = (moveA == 'c') ? 'd' : 'c';
+		}
+
+		if (noiseB.flip())
+		{
+			moveB = (moveB == 'c') ? 'd' : 'c';
+		}
+
+		result.scoreA += getPayoff(0, moveA, moveB);
+		result.scoreB += getPayoff(1, moveB, moveA);
+
+		opponentOfA = moveB;
+		opponentOfB = moveA;
+	}
+
+	return result;
+}
+
+
+//Strategy policies for the specialised match kernels. Moves are 0 = cooperate, 1 = defect,
+//and move() sees the opponent's last move. Every call is resolved at compile time.
+//A deterministic policy keeps no state of its own, so its move depends only on the last moves.
+struct CooperatePolicy
+{
+	static constexpr bool deterministic = true;
+
+	int move(int) { return 0; }
+};
+
+struct EvilPolicy
+{
+	static constexpr bool deterministic = true;
+
+	int move(int) { return 1; }
+};
+
+struct TitForTatPolicy
+{
+	static constexpr bool deterministic = true;
+
+	int move(int opponentLastMove) { return opponentLastMove; }
+};
+
+struct RandomPolicy
+{
+	static constexpr bool deterministic = false;
+
+	RandomStream random;
+
+	int move(int) { return random.nextBit(); }
+};
+
+
+//Match loop for one pair of strategy policies, fully inlined for that pair.
+//Between two deterministic policies the joint state (both last moves) has only four values,
+//so it repeats within five rounds; from then on the match is periodic and the remaining
+//whole cycles are scored at once, leaving fewer than one cycle to simulate.
+//The Noisy instantiation flips moves through the sides' NoiseStreams and never fast-forwards;
+//the noise-free one has no trace of it.
+template <bool Noisy, class PolicyA, class PolicyB>
+MatchResult runMatchKernel(PolicyA a, PolicyB b, int opponentOfA, int opponentOfB, const MatchConfig& config)
+{
+	long long rounds = config.rounds;
+	long long scoreA = 0, scoreB = 0;
+	const int32_t* payoffA = payoffs.table[0];
+	const int32_t* payoffB = payoffs.table[1];
+	long long i = 0;
+
+	if constexpr (PolicyA::deterministic && PolicyB::deterministic && !Noisy)
+	{
+		long long seenAt[4] = { -1, -1, -1, -1 };
+		long long seenScoreA[4] = { 0 }, seenScoreB[4] = { 0 };
+
+		for (; i < rounds; i++)
+		{
+			int state = (opponentOfA << 1) | opponentOfB;
+
+			if (seenAt[state] >= 0)
+			{
+				long long length = i - seenAt[state];
+				long long cycles = (rounds - i) / length;
+
+				scoreA += cycles * (scoreA - seenScoreA[state]);
+				scoreB += cycles * (scoreB - seenScoreB[state]);
+				i += cycles * length;
+				IPD_COUNT(CounterSkippedRounds, cycles * length);
+				break;
+			}
+
+			seenAt[state] = i;
+			seenScoreA[state] = scoreA;
+			seenScoreB[state] = scoreB;
+
+			int moveA = a.move(opponentOfA);
+			int moveB = b.move(opponentOfB);
+
+			scoreA += payoffA[(moveA << 1) | moveB];
+			scoreB += payoffB[(moveB << 1) | moveA];
+
+			opponentOfA = moveB;
+			opponentOfB = moveA;
+		}
+	}
+
+	if constexpr (Noisy)
+	{
+		NoiseStream noiseA, noiseB;
+		noiseA.seed(config.noiseA, config.seed, config.matchID, config.idA);
+		noiseB.seed(config.noiseB, config.seed, config.matchID, config.idB);
+
+		for (; i < rounds; i++)
+		{
+			int moveA = a.move(opponentOfA) ^ (int)noiseA.flip();
+			int moveB = b.move(opponentOfB) ^ (int)noiseB.flip();
+
+			scoreA += payoffA[(moveA << 1) | moveB];
+			scoreB += payoffB[(moveB << 1) | moveA];
+
+			opponentOfA = moveB;
+			opponentOfB = moveA;
+		}
+	}
+
+	//Random pairings, and the tail of a deterministic match after fast-forwarding
+	for (; i < rounds; i++)
+	{
+		int moveA = a.move(opponentOfA);
+		int moveB = b.move(opponentOfB);
+
+		scoreA += payoffA[(moveA << 1) | moveB];
+		scoreB += payoffB[(moveB << 1) | moveA];
+
+		opponentOfA = moveB;
+		opponentOfB = moveA;
+	}
+
+	MatchResult result;
+	result.scoreA = scoreA;
+	result.scoreB = scoreB;
+	return result;
+}
+
+//Seed a policy's random stream (only the Random policy has one)
+inline void makePolicy(CooperatePolicy&, const MatchConfig&, uint64_t) {}
+inline void makePolicy(EvilPolicy&, const MatchConfig&, uint64_t) {}
+inline void makePolicy(TitForTatPolicy&, const MatchConfig&, uint64_t) {}
+inline void makePolicy(RandomPolicy& policy, const MatchConfig& config, uint64_t playerID)
+{
+	policy.random.seed(config.seed, config.matchID, playerID);
+}
+
+//Second level of the dispatch: PolicyA is known, pick PolicyB from the strategy code
+template <bool Noisy, class PolicyA>
+MatchResult dispatchMatchKernel(PolicyA a, const MatchConfig& config)
+{
+	int opponentOfA = (config.strategyA == 't' && config.firstMoveA == 'd') ? 1 : 0;
+	int opponentOfB = (config.strategyB == 't' && config.firstMoveB == 'd') ? 1 : 0;
+
+	switch (config.strategyB)
+	{
+		case 'r':
+		{
+			RandomPolicy b;
+			makePolicy(b, config, config.idB);
+			return runMatchKernel<Noisy>(a, b, opponentOfA, opponentOfB, config);
+		}
+
+		case 'c':
+			return runMatchKernel<Noisy>(a, CooperatePolicy(), opponentOfA, opponentOfB, config);
+
+		case 'e':
+			return runMatchKernel<Noisy>(a, EvilPolicy(), opponentOfA, opponentOfB, config);
+
+		case 't':
+			return runMatchKernel<Noisy>(a, TitForTatPolicy(), opponentOfA, opponentOfB, config);
+
+		default:
+			return playMatchGeneric(config);
+	}
+}
+
+//First level of the dispatch: pick PolicyA from the strategy code
+template <bool Noisy>
+MatchResult dispatchMatchKernel(const MatchConfig& config)
+{
+	switch (config.strategyA)
+	{
+		case 'r':
+		{
+			RandomPolicy a;
+			makePolicy(a, config, config.idA);
+			return dispatchMatchKernel<Noisy>(a, config);
+		}
+
+		case 'c':
+			return dispatchMatchKernel<Noisy>(CooperatePolicy(), config);
+
+		case 'e':
+			return dispatchMatchKernel<Noisy>(EvilPolicy(), config);
+
+		case 't':
+			return dispatchMatchKernel<Noisy>(TitForTatPolicy(), config);
+
+		default:
+			return playMatchGeneric(config);
+	}
+}
+
+//Select the match loop. The strategy pair is dispatched once per match to its own specialised
+//loop, so there is no per-move switch; unknown codes fall back to the generic path.
+static MatchResult selectMatchKernel(const MatchConfig& config)
+{
+	if (config.tableA != nullptr || config.tableB != nullptr)
+	{
+		return playTableMatch(config, true);
+	}
+
+	if (config.noiseA > 0 || config.noiseB > 0)
+	{
+		return dispatchMatchKernel<true>(config);
+	}
+
+	return dispatchMatchKernel<false>(config);
+}
+
+//Play one match, recording its latency and moves when instrumentation is compiled in
+MatchResult playMatch(const MatchConfig& config)
+{
+#ifdef IPD_METRICS
+	auto start = chrono::steady_clock::now();
+	MatchResult result = selectMatchKernel(config);
+	long long nanos = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+
+	Metrics::addMatch(config.tableA ? config.tableA->getName() : string(), config.strategyA,
+		config.tableB ? config.tableB->getName() : string(), config.strategyB, config.rounds, nanos);
+	return result;
+#else
+	return selectMatchKernel(config);
+#endif
+}
+
+//Transpose a 64x64 bit matrix in place: afterwards bit l of word i is what bit i of word l was
+void transpose64(uint64_t a[64])
+{
+	uint64_t mask = 0x00000000FFFFFFFFULL;
+
+	for (int j = 32; j != 0; j >>= 1, mask ^= mask << j)
+	{
+		for (int k = 0; k < 64; k = ((k | j) + 1) & ~j)
+		{
+			uint64_t t = ((a[k] >> j) ^ a[k | j]) & mask;
+			a[k] ^= t << j;
+			a[k | j] ^= t;
+		}
+	}
+}
+
+
+//Map a trace file read-only and check that its sections lie inside it
+bool TraceReader::open(const string& path, string& error)
+{
+	close();
+
+#ifdef _WIN32
+	HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	LARGE_INTEGER size;
+
+	if (handle == INVALID_HANDLE_VALUE || !GetFileSizeEx(handle, &size))
+	{
+		if (handle != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(handle);
+		}
+
+		error = "Cannot open trace file '" + path + "'";
+		return false;
+	}
+
+	length = (uint64_t)size.QuadPart;
+	fileHandle = handle;
+
+	if (length >= sizeof(TraceHeader))
+	{
+		mappingHandle = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		data = mappingHandle ? (const uint8_t*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	}
+#else
+	int descriptor = ::open(path.c_str(), O_RDONLY);
+	struct stat status;
+
+	if (descriptor < 0 || fstat(descriptor, &status) != 0)
+	{
+		if (descriptor >= 0)
+		{
+			::close(descriptor);
+		}
+
+		error = "Cannot open trace file '" + path + "'";
+		return false;
+	}
+
+	length = (uint64_t)status.st_size;
+
+	if (length >= sizeof(TraceHeader))
+	{
+		void* mapping = mmap(nullptr, (size_t)length, PROT_READ, MAP_PRIVATE, descriptor, 0);
+		data = (mapping == MAP_FAILED) ? nullptr : (const uint8_t*)mapping;
+	}
+
+	//The mapping stays valid after the descriptor is closed
+	::close(descriptor);
+#endif
+
+	if (data == nullptr)
+	{
+		close();
+		error = "'" + path + "' is too short or cannot be mapped";
+		return false;
+	}
+
+	header = (const TraceHeader*)data;
+
+	//Sizes are bounded by the file length before any arithmetic on them, so a damaged or crafted
+	//header cannot overflow it. The sections must be 8-byte aligned, follow the header and fill the
+	//rest of the file exactly, as TraceWriter lays them out.
+	uint64_t rounds = header->rounds;
+	uint64_t blocks = header->numOfBlocks;
+	uint64_t movesOffset = header->movesOffset;
+	uint64_t indexOffset = header->indexOffset;
+	bool valid = memcmp(header->magic, "IPDTRACE", 8) == 0 && header->version == 2 && header->blockRounds != 0
+		&& header->blockRounds % 64 == 0 && rounds / 4 <= length && blocks < length / (4 * sizeof(int64_t))
+		&& blocks == (rounds + header->blockRounds - 1) / header->blockRounds
+		&& movesOffset >= sizeof(TraceHeader) && movesOffset % 8 == 0 && indexOffset % 8 == 0
+		&& movesOffset <= indexOffset && indexOffset <= length;
+
+	if (valid)
+	{
+		uint64_t words = 2 * ((rounds + 63) / 64);
+		valid = indexOffset - movesOffset == words * sizeof(uint64_t)
+			&& length - indexOffset == 4 * (blocks + 1) * sizeof(int64_t);
+	}
+
+	if (!valid)
+	{
+		close();
+		error = "'" + path + "' is not a valid match trace";
+		return false;
+	}
+
+	moves = (const uint64_t*)(data + movesOffset);
+	index = (const int64_t*)(data + indexOffset);
+	return true;
+}
+
+//Unmap the trace, if one is open
+void TraceReader::close()
+{
+#ifdef _WIN32
+	if (data != nullptr)
+	{
+		UnmapViewOfFile(data);
+	}
+
+	if (mappingHandle != nullptr)
+	{
+		CloseHandle(mappingHandle);
+	}
+
+	if (fileHandle != nullptr)
+	{
+		CloseHandle(fileHandle);
+	}
+
+	fileHandle = nullptr;
+	mappingHandle = nullptr;
+#else
+	if (data != nullptr)
+	{
+		munmap((void*)data, (size_t)length);
+	}
+#endif
+
+	data = nullptr;
+	length = 0;
+	header = nullptr;
+	moves = nullptr;
+	index = nullptr;
+}
+
+
+//Write a file through a uniquely named temporary that is flushed and then renamed over the target;
+//on POSIX the directory is flushed as well, so the rename itself survives a crash
+bool writeFileAtomically(const string& path, const void* data, size_t size, string& error)
+{
+#ifdef _WIN32
+	//The process ID and a counter keep concurrent writers, in this process or others, apart
+	static atomic<unsigned> counter(0);
+	string temporary = path + ".tmp" + to_string(GetCurrentProcessId()) + "." + to_string(counter.fetch_add(1));
+	HANDLE handle = CreateFileA(temporary.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
+	DWORD written = 0;
+
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		error = "Cannot create '" + temporary + "'";
+		return false;
+	}
+
+	bool ok = WriteFile(handle, data, (DWORD)size, &written, nullptr) && written == size && FlushFileBuffers(handle);
+	CloseHandle(handle);
+
+	if (!ok || !MoveFileExA(temporary.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+	{
+		DeleteFileA(temporary.c_str());
+		error = "Cannot write '" + path + "'";
+		return false;
+	}
+#else
+	//mkstemp picks a name no other writer is using
+	string temporary = path + ".XXXXXX";
+	int descriptor = mkstemp(&temporary[0]);
+
+	if (descriptor < 0)
+	{
+		error = "Cannot create a temporary file next to '" + path + "'";
+		return false;
+	}
+
+	const char* bytes = (const char*)data;
+	size_t done = 0;
+
+	while (done < size)
+	{
+		ssize_t written = ::write(descriptor, bytes + done, size - done);
+		if (written <= 0)
+		{
+			break;
+		}
+
+		done += (size_t)written;
+	}
+
+	//mkstemp creates the file private to its owner; give it the usual permissions. The data must
+	//be on disk before the rename makes it the file.
+	bool ok = done == size && fchmod(descriptor, 0644) == 0 && fsync(descriptor) == 0;
+	ok = (::close(descriptor) == 0) && ok;
+
+	if (!ok || rename(temporary.c_str(), path.c_str()) != 0)
+	{
+		unlink(temporary.c_str());
+		error = "Cannot write '" + path + "'";
+		return false;
+	}
+
+	//Flush the directory entry the rename changed; some file systems cannot sync a directory
+	size_t slash = path.rfind('/');
+	string directory = (slash == string::npos) ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+	int directoryDescriptor = ::open(directory.c_str(), O_RDONLY);
+
+	if (directoryDescriptor >= 0)
+	{
+		ok = fsync(directoryDescriptor) == 0 || errno == EINVAL;
+		::close(directoryDescriptor);
+
+		if (!ok)
+		{
+			error = "Cannot flush the directory of '" + path + "'";
+			return false;
+		}
+	}
+#endif
+
+	return true;
+}
+
+//Load a checkpoint after checking it belongs to this tournament and is intact
+bool Tournament::resume(const string& path, string& error)
+{
+	ifstream file(path, ios::binary);
+
+	if (!file)
+	{
+		error = "Cannot open checkpoint '" + path + "'";
+		return false;
+	}
+
+	CheckpointHeader header;
+	long long n = (long long)names.size();
+	vector<long long> saved(names.size());
+
+	if (!file.read((char*)&header, sizeof(header)) || memcmp(header.magic, "IPDCKPT", 8) != 0 || header.version != 1
+		|| header.numOfEntrants != (uint32_t)n || !file.read((char*)saved.data(), saved.size() * sizeof(int64_t)))
+	{
+		error = "'" + path + "' is not a valid checkpoint for this tournament";
+		return false;
+	}
+
+	Fingerprint checksum;
+	checksum.add(saved.data(), saved.size() * sizeof(int64_t));
+
+	if (header.checksum != checksum.get())
+	{
+		error = "'" + path + "' is corrupt";
+		return false;
+	}
+
+	//Anything that changes a score (entrants, rounds, seed, noise, payoffs, engine) changes the
+	//fingerprint, so a checkpoint can only continue the run that wrote it
+	if (header.fingerprint != fingerprint() || header.numOfPairings != (uint64_t)(n * (n - 1) / 2)
+		|| header.nextPairing > header.numOfPairings)
+	{
+		error = "'" + path + "' was written by a different tournament configuration";
+		return false;
+	}
+
+	scores = saved;
+	firstPairing = (long long)header.nextPairing;
+	resumed = true;
+	return true;
+}
+
+//Read a cache file written by save()
+bool OutcomeCache::load(const string& path, string& error)
+{
+	ifstream file(path, ios::binary);
+
+	if (!file)
+	{
+		return true; //Nothing cached yet
+	}
+
+	OutcomeCacheHeader header;
+	file.seekg(0, ios::end);
+	long long size = (long long)file.tellg();
+	file.seekg(0, ios::beg);
+
+	//The slots must fit in memory and fill the rest of the file exactly, checked before allocating them
+	if (!file.read((char*)&header, sizeof(header)) || memcmp(header.magic, "IPDMEMO", 8) != 0 || header.version != 1
+		|| header.capacity < 2 || (header.capacity & (header.capacity - 1)) != 0 || header.capacity > (uint64_t)maxCapacity
+		|| header.numOfEntries > header.capacity / 2
+		|| size != (long long)(sizeof(header) + header.capacity * sizeof(OutcomeEntry)))
+	{
+		error = "'" + path + "' is not an outcome cache";
+		return false;
+	}
+
+	//Outcomes scored by another engine or under other payoffs would be wrong now
+	if (header.engine != engineVersion || memcmp(header.payoff, payoffs.table, sizeof(header.payoff)) != 0)
+	{
+		lock_guard<mutex> guard(lock);
+		invalidated = true;
+		return true;
+	}
+
+	vector<OutcomeEntry> saved((size_t)header.capacity);
+
+	if (!file.read((char*)saved.data(), saved.size() * sizeof(OutcomeEntry)))
+	{
+		error = "'" + path + "' is truncated";
+		return false;
+	}
+
+	long long count = 0;
+	for (const OutcomeEntry& entry : saved)
+	{
+		count += (entry.key != 0);
+	}
+
+	if (count != (long long)header.numOfEntries)
+	{
+		error = "'" + path + "' is corrupt";
+		return false;
+	}
+
+	lock_guard<mutex> guard(lock);
+	slots.swap(saved);
+	numOfEntries = count;
+	loaded = count;
+	maxEntries = max(maxEntries, count);
+	return true;
+}
+
+//Write the header and the slots through a temporary file
+bool OutcomeCache::save(const string& path, string& error)
+{
+	lock_guard<mutex> guard(lock);
+	OutcomeCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "IPDMEMO", 7);
+	header.version = 1;
+	header.engine = engineVersion;
+	memcpy(header.payoff, payoffs.table, sizeof(header.payoff));
+	header.capacity = (uint64_t)slots.size();
+	header.numOfEntries = (uint64_t)numOfEntries;
+
+	vector<char> buffer(sizeof(header) + slots.size() * sizeof(OutcomeEntry));
+	memcpy(buffer.data(), &header, sizeof(header));
+	memcpy(buffer.data() + sizeof(header), slots.data(), slots.size() * sizeof(OutcomeEntry));
+	return writeFileAtomically(path, buffer.data(), buffer.size(), error);
+}
+
+
+//Take the oldest unconsumed chunk's text; false if the queue is empty
+bool AsyncLog::pop(string& text)
+{
+	Chunk* next = tail->next.load(memory_order_acquire);
+
+	if (next == nullptr)
+	{
+		return false;
+	}
+
+	//next becomes the new consumed sentinel; the old one is released
+	text = move(next->text);
+
+	if (tail != &stub)
+	{
+		delete tail;
+	}
+
+	tail = next;
+	return true;
+}
+
+//Writer thread: drain the queue, waiting on wake whenever it is empty
+void AsyncLog::run()
+{
+	string text;
+
+	while (true)
+	{
+		bool stop = stopping.load(memory_order_acquire);
+		bool wrote = false;
+
+		while (pop(text))
+		{
+			fwrite(text.data(), 1, text.size(), file);
+			bytesWritten.fetch_add((long long)text.size(), memory_order_relaxed);
+			chunksWritten.fetch_add(1, memory_order_relaxed);
+			wrote = true;
+		}
+
+		if (wrote)
+		{
+			fflush(file);
+		}
+
+		//Chunks pushed before close() set stopping were drained by the loop above
+		if (stop)
+		{
+			break;
+		}
+
+		//Announce that we are idle, then look again: a producer that pushed before seeing the flag
+		//has its chunk found here, and one that pushes later finds the flag and signals
+		unique_lock<mutex> lock(wakeMutex);
+		idle.store(true);
+
+		wake.wait(lock, [this]() {
+			return !idle.load() || stopping.load() || tail->next.load() != nullptr;
+		});
+
+		idle.store(false);
+	}
+}
+
+void AsyncLog::start()
+{
+	stopping = false;
+	bytesWritten = 0;
+	chunksWritten = 0;
+	idle = false;
+
+	writer = thread(&AsyncLog::run, this);
+}
+
+//Start writing to a file (truncated); false if it cannot be created
+bool AsyncLog::open(const string& path)
+{
+	close();
+	file = fopen(path.c_str(), "wb");
+
+	if (file == nullptr)
+	{
+		return false;
+	}
+
+	ownsFile = true;
+
+	//Large stdio buffer so a drained batch goes out in few system calls
+	setvbuf(file, nullptr, _IOFBF, 1 << 20);
+	start();
+	return true;
+}
+
+//Start writing to stdout
+void AsyncLog::openStdout()
+{
+	close();
+	fflush(stdout);
+	file = stdout;
+	ownsFile = false;
+	start();
+}
+
+//Write everything queued so far and stop the writer thread
+void AsyncLog::close()
+{
+	if (file == nullptr)
+	{
+		return;
+	}
+
+	stopping.store(true);
+
+	{
+		lock_guard<mutex> lock(wakeMutex);
+		wake.notify_one();
+	}
+
+	writer.join();
+
+	if (ownsFile)
+	{
+		fclose(file);
+	}
+	else
+	{
+		fflush(file);
+	}
+
+	//Release the last consumed chunk and leave an empty queue for the next open()
+	if (tail != &stub)
+	{
+		delete tail;
+	}
+
+	stub.next = nullptr;
+	head = &stub;
+	tail = &stub;
+	file = nullptr;
+}
+
+#ifdef IPD_METRICS
+//Merge every thread's metrics and write them as key=value lines
+void Metrics::dump(ostream& out)
+{
+	static const char* phaseNames[NumOfPhases] = { "history", "dispatch", "scoring", "output", "payoffs", "tournament" };
+	static const char* counterNames[NumOfCounters] = { "matches", "rounds", "skipped_rounds", "table_matches", "generic_matches", "game_rounds" };
+
+	ThreadMetrics total;
+	size_t numOfThreads = 0;
+
+	{
+		lock_guard<mutex> lock(registryMutex());
+		numOfThreads = registry().size();
+
+		for (const unique_ptr<ThreadMetrics>& metrics : registry())
+		{
+			for (int p = 0; p < NumOfPhases; p++)
+			{
+				total.phaseNanos[p] += metrics->phaseNanos[p];
+				total.phaseCalls[p] += metrics->phaseCalls[p];
+			}
+
+			for (int c = 0; c < NumOfCounters; c++)
+			{
+				total.counters[c] += metrics->counters[c];
+			}
+
+			for (int code = 0; code < 256; code++)
+			{
+				total.builtinMoves[code] += metrics->builtinMoves[code];
+			}
+
+			for (const auto& entry : metrics->tableMoves)
+			{
+				total.tableMoves[entry.first] += entry.second;
+			}
+
+			for (int b = 0; b < numOfBuckets; b++)
+			{
+				total.latency[b] += metrics->latency[b];
+			}
+		}
+	}
+
+	out << "metrics threads=" << numOfThreads << '\n';
+
+	for (int p = 0; p < NumOfPhases; p++)
+	{
+		if (total.phaseCalls[p] > 0)
+		{
+			out << "phase=" << phaseNames[p] << " calls=" << total.phaseCalls[p]
+				<< " total_ms=" << (double)total.phaseNanos[p] / 1e6
+				<< " mean_ns=" << (double)total.phaseNanos[p] / (double)total.phaseCalls[p] << '\n';
+		}
+	}
+
+	for (int c = 0; c < NumOfCounters; c++)
+	{
+		out << "counter=" << counterNames[c] << " value=" << total.counters[c] << '\n';
+	}
+
+	for (int code = 0; code < 256; code++)
+	{
+		if (total.builtinMoves[code] > 0)
+		{
+			out << "strategy=" << (char)code << " moves=" << total.builtinMoves[code] << '\n';
+		}
+	}
+
+	vector<pair<string, long long>> tables(total.tableMoves.begin(), total.tableMoves.end());
+	sort(tables.begin(), tables.end());
+
+	for (const auto& entry : tables)
+	{
+		out << "strategy=" << entry.first << " moves=" << entry.second << '\n';
+	}
+
+	//Percentiles are reported as the upper edge of the bucket they fall in
+	long long matches = 0;
+	for (int b = 0; b < numOfBuckets; b++)
+	{
+		matches += total.latency[b];
+	}
+
+	if (matches > 0)
+	{
+		const double quantiles[3] = { 0.5, 0.9, 0.99 };
+		const char* labels[3] = { "p50", "p90", "p99" };
+
+		out << "latency matches=" << matches;
+
+		for (int q = 0; q < 3; q++)
+		{
+			long long seen = 0;
+			int b = 0;
+
+			while (b + 1 < numOfBuckets && (double)(seen + total.latency[b]) < quantiles[q] * (double)matches)
+			{
+				seen += total.latency[b];
+				b++;
+			}
+
+			out << ' ' << labels[q] << "_ns_below=" << (1LL << (b + 1));
+		}
+
+		out << '\n';
+
+		for (int b = 0; b < numOfBuckets; b++)
+		{
+			if (total.latency[b] > 0)
+			{
+				out << "latency_bucket from_ns=" << (1LL << b) << " to_ns=" << (1LL << (b + 1)) << " count=" << total.latency[b] << '\n';
+			}
+		}
+	}
+
+	out.flush();
+}
+
+//Write the dump to a file; false if it cannot be written
+bool Metrics::dump(const string& path)
+{
+	ofstream file(path);
+
+	if (!file)
+	{
+		return false;
+	}
+
+	dump(file);
+	return (bool)file;
+}
+#endif
+
+}
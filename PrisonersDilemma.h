@@ -0,0 +1,5256 @@
+/*---------------------------------------------------*/
+/* Program: PrisonersDilemma.h                       */
+/* Description: The Iterated Prisoner's Dilemma      */
+/* engine as a library: strategies, players, the     */
+/* game, the match kernels, tournaments, population  */
+/* dynamics and the genetic search. Nothing in here  */
+/* reads from the console; results are returned or   */
+/* written to a stream supplied by the caller.       */
+/*---------------------------------------------------*/
+
+#ifndef PRISONERS_DILEMMA_H
+#define PRISONERS_DILEMMA_H
+
+#include <ostream>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <climits>
+#include <charconv>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#define Max_Players 2
+
+namespace ipd
+{
+
+using namespace std;
+
+//Instrumentation, compiled in with IPD_METRICS. Every thread accumulates into its own
+//ThreadMetrics (no atomics or locks on the hot path); Metrics::dump merges them. Without
+//IPD_METRICS the macros expand to nothing and the engine carries no trace of it.
+enum MetricPhase
+{
+	PhaseHistory,    //Sizing and clearing move histories (Game::setNumberOfRounds, configureHistory)
+	PhaseDispatch,   //Choosing moves through Strategy::cooperateOrDefect in the game loop
+	PhaseScoring,    //Scoring the moves in the game loop
+	PhaseOutput,     //Formatting the per-round output
+	PhasePayoffs,    //Filling a PairPayoffCache
+	PhaseTournament, //Whole tournaments
+	NumOfPhases
+};
+
+enum MetricCounter
+{
+	CounterMatches,        //Matches played through playMatch
+	CounterRounds,         //Rounds of those matches
+	CounterSkippedRounds,  //Rounds scored by fast-forwarding whole cycles
+	CounterTableMatches,   //Matches played by the table kernel
+	CounterGenericMatches, //Matches played by the generic path
+	CounterGameRounds,     //Rounds played through the Game loop
+	NumOfCounters
+};
+
+#ifdef IPD_METRICS
+class Metrics
+{
+public:
+	static constexpr int numOfBuckets = 48; //Bucket b holds match latencies in [2^b, 2^(b+1)) ns
+
+	struct ThreadMetrics
+	{
+		long long phaseNanos[NumOfPhases] = {};
+		long long phaseCalls[NumOfPhases] = {};
+		long long counters[NumOfCounters] = {};
+		long long builtinMoves[256] = {};            //Moves per built-in strategy code
+		unordered_map<string, long long> tableMoves; //Moves per table strategy name
+		long long latency[numOfBuckets] = {};
+	};
+
+	//This thread's metrics, registered on first use and kept after the thread ends
+	static ThreadMetrics& local()
+	{
+		thread_local ThreadMetrics* metrics = nullptr;
+
+		if (metrics == nullptr)
+		{
+			lock_guard<mutex> lock(registryMutex());
+			registry().push_back(make_unique<ThreadMetrics>());
+			metrics = registry().back().get();
+		}
+
+		return *metrics;
+	}
+
+	static void addPhase(MetricPhase phase, long long nanos)
+	{
+		ThreadMetrics& metrics = local();
+		metrics.phaseNanos[phase] += nanos;
+		metrics.phaseCalls[phase]++;
+	}
+
+	static void count(MetricCounter counter, long long amount)
+	{
+		local().counters[counter] += amount;
+	}
+
+	//Record a finished match: its latency and the moves of both strategies
+	static void addMatch(const string& nameA, char codeA, const string& nameB, char codeB, long long rounds, long long nanos)
+	{
+		ThreadMetrics& metrics = local();
+		int bucket = 0;
+
+		while (bucket + 1 < numOfBuckets && (1LL << (bucket + 1)) <= nanos)
+		{
+			bucket++;
+		}
+
+		metrics.latency[bucket]++;
+		metrics.counters[CounterMatches]++;
+		metrics.counters[CounterRounds] += rounds;
+
+		if (nameA.empty())
+		{
+			metrics.builtinMoves[(unsigned char)codeA] += rounds;
+		}
+		else
+		{
+			metrics.tableMoves[nameA] += rounds;
+		}
+
+		if (nameB.empty())
+		{
+			metrics.builtinMoves[(unsigned char)codeB] += rounds;
+		}
+		else
+		{
+			metrics.tableMoves[nameB] += rounds;
+		}
+	}
+
+	//Merge every thread's metrics and write them as key=value lines
+	static void dump(ostream& out);
+
+	//Write the dump to a file; false if it cannot be written
+	static bool dump(const string& path);
+
+private:
+	static vector<unique_ptr<ThreadMetrics>>& registry()
+	{
+		static vector<unique_ptr<ThreadMetrics>> threads;
+		return threads;
+	}
+
+	static mutex& registryMutex()
+	{
+		static mutex registryLock;
+		return registryLock;
+	}
+};
+
+
+//Adds the time from construction to destruction to a phase
+class ScopedTimer
+{
+private:
+	MetricPhase phase;
+	chrono::steady_clock::time_point start;
+
+public:
+	ScopedTimer(MetricPhase timedPhase)
+	{
+		phase = timedPhase;
+		start = chrono::steady_clock::now();
+	}
+
+	//Destructor
+	~ScopedTimer()
+	{
+		Metrics::addPhase(phase, chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+	}
+};
+
+//Splits a stretch of code into consecutive phases: each lap() charges the time since the last
+//lap (or construction) to a phase
+class LapTimer
+{
+private:
+	chrono::steady_clock::time_point last;
+
+public:
+	LapTimer()
+	{
+		last = chrono::steady_clock::now();
+	}
+
+	void lap(MetricPhase phase)
+	{
+		chrono::steady_clock::time_point now = chrono::steady_clock::now();
+		Metrics::addPhase(phase, chrono::duration_cast<chrono::nanoseconds>(now - last).count());
+		last = now;
+	}
+};
+
+#define IPD_METRICS_JOIN2(a, b) a##b
+#define IPD_METRICS_JOIN(a, b) IPD_METRICS_JOIN2(a, b)
+#define IPD_TIME_SCOPE(phase) ipd::ScopedTimer IPD_METRICS_JOIN(phaseTimer, __LINE__)(phase)
+#define IPD_COUNT(counter, amount) ipd::Metrics::count(counter, amount)
+#define IPD_LAP_START(name) ipd::LapTimer name
+#define IPD_LAP(name, phase) name.lap(phase)
+#else
+#define IPD_TIME_SCOPE(phase) ((void)0)
+#define IPD_COUNT(counter, amount) ((void)0)
+#define IPD_LAP_START(name) ((void)0)
+#define IPD_LAP(name, phase) ((void)0)
+#endif
+
+
+//Class for generating unique IDs
+class generateID
+{
+private:
+	static int ID;
+
+public:
+
+	//Get the next available unique ID.
+	static int getID()
+	{
+		ID++;
+		return ID;
+	}
+
+	//Reset the static ID variable in the generateID class back to zero.
+	static void resetID()
+	{
+		ID = 0;
+	}
+};
+
+//Class producing a reproducible stream of random numbers without shared state.
+//Every draw is a pure function of (global seed, match ID, player ID, draw counter), using
+//the splitmix64 mixer, so each match/player pair has its own independent stream and results
+//do not depend on which thread runs a match or in what order.
+class RandomStream
+{
+private:
+	uint64_t key;
+	uint64_t counter;
+	uint64_t bits;
+	int bitsLeft;
+	uint64_t halfWord;
+	bool hasHalfWord;
+
+	//splitmix64 finalizer
+	static uint64_t mix(uint64_t z)
+	{
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	}
+
+public:
+	//Default Constructor
+	RandomStream()
+	{
+		seed(0, 0, 0);
+	}
+
+	//Select the stream for a player in a match under the given global seed
+	void seed(uint64_t globalSeed, uint64_t matchID, uint64_t playerID)
+	{
+		key = mix(globalSeed + 0x9E3779B97F4A7C15ULL);
+		key = mix(key ^ (matchID + 0xA0761D6478BD642FULL));
+		key = mix(key ^ (playerID + 0xE7037ED1A0B428DBULL));
+		counter = 0;
+		bits = 0;
+		bitsLeft = 0;
+		halfWord = 0;
+		hasHalfWord = false;
+	}
+
+	//Next 64 random bits
+	uint64_t nextWord()
+	{
+		counter++;
+		return mix(key + counter * 0x9E3779B97F4A7C15ULL);
+	}
+
+	//Next random bit, taken from a buffered word so a draw is a shift in the common case
+	int nextBit()
+	{
+		if (bitsLeft == 0)
+		{
+			bits = nextWord();
+			bitsLeft = 64;
+		}
+
+		int bit = (int)(bits & 1);
+		bits >>= 1;
+		bitsLeft--;
+		return bit;
+	}
+
+	//Next 32 random bits; each word drawn serves two calls
+	uint32_t next32()
+	{
+		if (hasHalfWord)
+		{
+			hasHalfWord = false;
+			return (uint32_t)halfWord;
+		}
+
+		uint64_t word = nextWord();
+		halfWord = word;
+		hasHalfWord = true;
+		return (uint32_t)(word >> 32);
+	}
+
+	//Uniform double in [0, 1)
+	double nextDouble()
+	{
+		return (nextWord() >> 11) * (1.0 / 9007199254740992.0);
+	}
+};
+
+
+//Class deciding which of a player's moves are flipped by implementation noise (the "trembling
+//hand"): each move is flipped independently with probability errorRate. Rather than a draw per
+//move, the number of error-free moves before the next flip is drawn from the geometric
+//distribution, so a move without an error costs a decrement and no random numbers.
+class NoiseStream
+{
+private:
+	RandomStream random;
+	double errorRate;
+	double logKeep; //log(1 - errorRate)
+	long long gap;  //Error-free moves left before the next flip
+
+	//Error-free moves before the next flip, by inversion of the geometric distribution
+	long long drawGap()
+	{
+		if (errorRate <= 0)
+		{
+			return LLONG_MAX;
+		}
+
+		double moves = floor(log1p(-random.nextDouble()) / logKeep);
+		return (moves < 9e18) ? (long long)moves : LLONG_MAX;
+	}
+
+public:
+	//Default Constructor
+	NoiseStream()
+	{
+		errorRate = 0;
+		logKeep = 0;
+		gap = LLONG_MAX;
+	}
+
+	//Set the error rate and select the stream for a player in a match. The stream is apart from
+	//the one of the player's Random moves, so adding noise does not change the moves themselves.
+	void seed(double rate, uint64_t globalSeed, uint64_t matchID, uint64_t playerID)
+	{
+		errorRate = min(max(rate, 0.0), 1.0);
+		logKeep = log1p(-errorRate);
+		random.seed(globalSeed, matchID, playerID ^ 0x8000000000000000ULL);
+		gap = drawGap();
+	}
+
+	bool isActive() const
+	{
+		return errorRate > 0;
+	}
+
+	//Whether the next move is flipped
+	bool flip()
+	{
+		if (gap > 0)
+		{
+			gap--;
+			return false;
+		}
+
+		gap = drawGap();
+		return true;
+	}
+
+	//Flips of the next 64 moves, bit i for move i; the same flips as 64 calls of flip()
+	uint64_t nextBlock()
+	{
+		uint64_t flips = 0;
+		long long position = 0;
+
+		while (gap < 64 - position)
+		{
+			position += gap;
+			flips |= 1ULL << position;
+			position++;
+			gap = drawGap();
+		}
+
+		gap -= 64 - position;
+		return flips;
+	}
+};
+
+
+//How much of the opponent's history a strategy looks at
+enum HistoryNeed
+{
+	NoHistory, //The move does not depend on the past (Random, Cooperate, Evil)
+	LastMove   //Only the opponent's last move (Tit for Tat)
+};
+
+//Class defining different strategies for the players
+class Strategy
+{
+private:
+	char strategyCode;
+	RandomStream random; //Source of the Random strategy's moves
+
+
+public:
+	//Default Constructor
+	Strategy()
+	{
+		strategyCode = 'r'; //Default strategy is Random
+	}
+
+
+	//Setter for strategyCode
+	void setStrategyCode(char code)
+	{
+		strategyCode = code;
+	}
+
+	//Getter for strategyCode
+	char getStrategyCode()
+	{
+		return strategyCode;
+	}
+
+	//Select the random stream used by the Random strategy
+	void seedRandom(uint64_t globalSeed, uint64_t matchID, uint64_t playerID)
+	{
+		random.seed(globalSeed, matchID, playerID);
+	}
+
+	//Kind of history this strategy needs to decide its move
+	HistoryNeed getHistoryNeed()
+	{
+		switch (strategyCode)
+		{
+			case 't':
+				return LastMove;
+
+			default:
+				return NoHistory;
+		}
+	}
+
+	//Number of the opponent's most recent moves this strategy reads
+	int getHistoryDepth()
+	{
+		switch (getHistoryNeed())
+		{
+			case LastMove:
+				return 1;
+
+			default:
+				return 0;
+		}
+	}
+
+	//Function to determine the move based on the strategy
+	char cooperateOrDefect(char opponentLastMove)
+	{
+		switch (strategyCode)
+		{
+
+			case 'r':  // Random
+			{
+				if (random.nextBit() == 0) {
+					return 'c';
+				}
+				else {
+					return 'd';
+				}
+			}
+
+			case 'c':  // Cooperate
+				return 'c';
+
+			case 'e':  // Evil
+				return 'd';
+
+			case 't':  // Tit for Tat
+				return opponentLastMove;
+
+			default:  //Unknown codes are rejected by the front ends; '\0' marks them here
+				return '\0';
+		}
+	}
+
+};
+
+
+//Count the set bits of a 64-bit word
+inline int countBits(uint64_t word)
+{
+#ifdef _MSC_VER
+	return (int)__popcnt64(word);
+#else
+	return __builtin_popcountll(word);
+#endif
+}
+
+//Index of the lowest set bit of a non-zero 64-bit word
+inline int lowestBit(uint64_t word)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, word);
+	return (int)index;
+#else
+	return __builtin_ctzll(word);
+#endif
+}
+
+
+//Class storing a sequence of moves packed one bit per move (1 = defect), 64 moves per word.
+//With a capacity set it becomes a ring buffer keeping only the most recent moves, so memory
+//stays constant however many moves are played. Moves keep their absolute index either way.
+class MoveHistory
+{
+private:
+	vector<uint64_t> words;
+	uint64_t numOfMoves;
+	uint64_t numOfDefections;
+	uint64_t capacity; //0 = keep every move, otherwise a multiple of 64
+	uint64_t oldest;   //Moves before this index were dropped when the capacity changed
+
+	//Mask selecting bits [from, to) of a word
+	static uint64_t rangeMask(uint64_t from, uint64_t to)
+	{
+		uint64_t upper = (to == 64) ? ~0ULL : ((1ULL << to) - 1);
+		return upper & ~((1ULL << from) - 1);
+	}
+
+	//Bit position of the move with the given absolute index
+	uint64_t position(uint64_t index) const
+	{
+		return (capacity == 0) ? index : index % capacity;
+	}
+
+public:
+	//Default Constructor
+	MoveHistory()
+	{
+		numOfMoves = 0;
+		numOfDefections = 0;
+		capacity = 0;
+		oldest = 0;
+	}
+
+	//Reserve space for the given number of moves and forget the stored ones
+	void reserve(uint64_t moves)
+	{
+		clear();
+		if (capacity == 0)
+		{
+			words.reserve((size_t)((moves + 63) / 64));
+		}
+	}
+
+	void clear()
+	{
+		numOfMoves = 0;
+		numOfDefections = 0;
+		oldest = 0;
+
+		if (capacity == 0)
+		{
+			words.clear();
+		}
+		else
+		{
+			fill(words.begin(), words.end(), 0);
+		}
+	}
+
+	//Keep only the most recent moves (rounded up to whole words), or every move if moves is 0.
+	//Moves that still fit in the new capacity are preserved.
+	void setCapacity(uint64_t moves)
+	{
+		uint64_t newCapacity = (moves + 63) / 64 * 64;
+		if (newCapacity == capacity)
+		{
+			return;
+		}
+
+		uint64_t keep = available();
+		if (newCapacity != 0 && keep > newCapacity)
+		{
+			keep = newCapacity;
+		}
+
+		vector<char> recent;
+		for (uint64_t i = numOfMoves - keep; i < numOfMoves; i++)
+		{
+			recent.push_back(get(i));
+		}
+
+		capacity = newCapacity;
+		oldest = numOfMoves - keep;
+		words.assign((size_t)(capacity == 0 ? (numOfMoves + 63) / 64 : capacity / 64), 0);
+
+		for (uint64_t i = 0; i < keep; i++)
+		{
+			uint64_t pos = position(numOfMoves - keep + i);
+			if (recent[(size_t)i] == 'd')
+			{
+				words[(size_t)(pos >> 6)] |= 1ULL << (pos & 63);
+			}
+		}
+	}
+
+	bool isBounded() const
+	{
+		return capacity != 0;
+	}
+
+	//Total number of moves ever pushed
+	uint64_t size() const
+	{
+		return numOfMoves;
+	}
+
+	//Number of most recent moves that can still be read
+	uint64_t available() const
+	{
+		uint64_t count = numOfMoves - oldest;
+		return (capacity != 0 && count > capacity) ? capacity : count;
+	}
+
+	//Total number of defections ever pushed
+	uint64_t totalDefections() const
+	{
+		return numOfDefections;
+	}
+
+	//Append a move ('c' or 'd')
+	void push(char move)
+	{
+		uint64_t pos = position(numOfMoves);
+		size_t word = (size_t)(pos >> 6);
+
+		if (capacity == 0 && (pos & 63) == 0)
+		{
+			words.push_back(0);
+		}
+
+		if (move == 'd')
+		{
+			words[word] |= 1ULL << (pos & 63);
+			numOfDefections++;
+		}
+		else
+		{
+			words[word] &= ~(1ULL << (pos & 63));
+		}
+
+		numOfMoves++;
+	}
+
+	//Move with absolute index (0 is the first move); must be one of the available moves
+	char get(uint64_t index) const
+	{
+		uint64_t pos = position(index);
+		return ((words[(size_t)(pos >> 6)] >> (pos & 63)) & 1) ? 'd' : 'c';
+	}
+
+	char last() const
+	{
+		return get(numOfMoves - 1);
+	}
+
+	//Number of defections among the last k available moves, counted a word at a time
+	uint64_t countDefections(uint64_t k) const
+	{
+		if (k > available())
+		{
+			k = available();
+		}
+
+		uint64_t index = numOfMoves - k;
+		uint64_t count = 0;
+
+		//A word never straddles the ring's wrap point because the capacity is a multiple of 64
+		while (index < numOfMoves)
+		{
+			uint64_t pos = position(index);
+			uint64_t span = min<uint64_t>(64 - (pos & 63), numOfMoves - index);
+			count += countBits(words[(size_t)(pos >> 6)] & rangeMask(pos & 63, (pos & 63) + span));
+			index += span;
+		}
+
+		return count;
+	}
+
+	//Number of cooperations among the last k available moves
+	uint64_t countCooperations(uint64_t k) const
+	{
+		return min(k, available()) - countDefections(k);
+	}
+};
+
+
+//Class representing player in the game.
+class Player
+{
+private:
+	int ID;
+	string name;
+	long long score;
+	long long numOfMoves;
+	long long totalMoves;
+	MoveHistory prevMoves;
+	char firstMove;
+	Strategy s;
+	double errorRate; //Probability that a move is flipped by implementation noise
+	NoiseStream noise;
+	static int numOfPlayers;
+
+
+public:
+	//Default Constructor
+	Player()
+	{
+		ID = generateID::getID();
+		name = "";
+		score = 0;
+		numOfMoves = 0;
+		totalMoves = 0;
+		firstMove = 'c';
+		errorRate = 0;
+		numOfPlayers++;
+	}
+
+
+	//Copy Constructor
+	Player(const Player& other)
+	{
+		//Copy primitive data members
+		ID = other.ID;
+		name = other.name;
+		score = other.score;
+		numOfMoves = other.numOfMoves;
+		totalMoves = other.totalMoves;
+		firstMove = other.firstMove;
+
+		//Each copy owns its own history
+		prevMoves = other.prevMoves;
+
+		//Copy strategy (assuming that Strategy has an appropriate copy constructor)
+		s = other.s;
+		errorRate = other.errorRate;
+		noise = other.noise;
+	}
+
+	//Move Constructor: takes over the other player's history instead of copying it
+	Player(Player&& other) = default;
+
+	Player& operator=(const Player& other) = default;
+	Player& operator=(Player&& other) = default;
+
+	//Accessors
+	int getID()
+	{
+		return ID;
+	}
+
+	string getName()
+	{
+		return name;
+	}
+
+	long long getScore()
+	{
+		return score;
+	}
+
+	char getStrategy()
+	{
+		return s.getStrategyCode();
+	}
+
+	long long getNumOfMoves() {
+		return numOfMoves;
+	}
+
+	char getFirstMove()
+	{
+		return firstMove;
+	}
+
+	char getLastMove(int x)
+	{
+		if (x >= 0 && x < numOfMoves && (numOfPlayers - 1 - x) <= (long long)prevMoves.available()) 
+		{
+			return prevMoves.get(numOfMoves - (numOfPlayers - 1) + x);
+		}
+		else
+		{
+			return '\0'; //The move is not available
+		}
+	}
+
+	//Number of times this player defected in their last k moves
+	int countRecentDefections(int k)
+	{
+		return (int)prevMoves.countDefections(k);
+	}
+
+
+	//Modifiers
+	void setName(string playerName)
+	{
+		name = playerName;
+	}
+
+	//First move used by tit for tat when the game runs without prompting
+	void setFirstMove(char move)
+	{
+		firstMove = move;
+	}
+
+	void setNumberOfMoves(int initTotalMoves)
+	{
+		//Calculating total moves considering we do not know that the number of players is 2
+		totalMoves = (long long)initTotalMoves * (numOfPlayers - 1); 
+
+		//Storage is sized later by setHistoryWindow, not by the number of rounds
+		prevMoves.clear();
+
+	}
+
+	//Number of this player's most recent moves that must stay readable (0 keeps every move)
+	void setHistoryWindow(long long moves)
+	{
+		prevMoves.setCapacity(moves);
+	}
+
+	//Number of the opponent's recent moves this player's strategy reads
+	int getHistoryDepth()
+	{
+		return s.getHistoryDepth();
+	}
+
+
+	void updateStrategy(char code)
+	{
+		s.setStrategyCode(code);
+	}
+
+	//Probability that each move is flipped; takes effect when the random streams are next seeded
+	void setErrorRate(double rate)
+	{
+		errorRate = rate;
+	}
+
+	double getErrorRate()
+	{
+		return errorRate;
+	}
+
+	//Select this player's random streams (moves and noise) for the given seed and match
+	void seedRandom(uint64_t globalSeed, uint64_t matchID)
+	{
+		s.seedRandom(globalSeed, matchID, ID);
+		noise.seed(errorRate, globalSeed, matchID, ID);
+	}
+
+	char makeMove(char opponentMove)
+	{
+		char move = s.cooperateOrDefect(opponentMove);
+
+		if (noise.flip())
+		{
+			move = (move == 'c') ? 'd' : 'c';
+		}
+		
+		//A bounded history overwrites its oldest move, so it never runs out of space;
+		//an unbounded one ignores moves beyond the rounds it was sized for
+		if (prevMoves.isBounded() || numOfMoves <= totalMoves)
+		{
+			setLastMove(move);
+		}
+
+		return move;
+	}
+
+
+	void setLastMove(char newMove)
+	{
+		prevMoves.push(newMove);
+		numOfMoves++;
+	}
+
+
+	//Functions
+	void printMoves(ostream& out, char move)
+	{
+		//The line is assembled here and written at once, with no flush: the stream may be buffered
+		char line[64] = "Player ";
+		char* end = to_chars(line + 7, line + 20, ID).ptr;
+		const char* text = (move == 'c') ? " Move: Cooperate\n\n" : " Move: Defect\n\n";
+		size_t length = strlen(text);
+
+		memcpy(end, text, length);
+		out.write(line, (end - line) + (streamsize)length);
+	}
+
+	void increaseScore(long long newScore)
+	{
+		score += newScore;
+	}
+
+	void setScore(long long newScore)
+	{
+		score = newScore;
+	}
+
+	void resetData()
+	{
+		score = 0;
+		numOfMoves = 0;
+		prevMoves.clear();
+	}
+
+	//Release the memory held by the player's previous moves
+	void resetMoves()
+	{
+		prevMoves = MoveHistory();
+	}
+
+	static void resetNumOfPlayers()
+	{
+		numOfPlayers = 0;
+	}
+
+	//Number of players in the game, which fixes how many moves each player makes per round
+	static void setNumOfPlayers(int count)
+	{
+		numOfPlayers = count;
+	}
+};
+
+
+//Version of the match semantics. Bump it whenever the same configuration would score differently,
+//so checkpoints and cached outcomes of an older engine are refused rather than silently mixed in.
+constexpr uint32_t engineVersion = 1;
+
+//Incremental FNV-1a hash, used to fingerprint the configuration a saved result belongs to. A
+//different offset basis gives a second, independent hash of the same data.
+class Fingerprint
+{
+private:
+	uint64_t hash;
+
+public:
+	//Default Constructor
+	Fingerprint(uint64_t basis = 14695981039346656037ULL)
+	{
+		hash = basis;
+	}
+
+	void add(const void* data, size_t size)
+	{
+		const unsigned char* bytes = (const unsigned char*)data;
+
+		for (size_t k = 0; k < size; k++)
+		{
+			hash = (hash ^ bytes[k]) * 1099511628211ULL;
+		}
+	}
+
+	//Strings are length-prefixed so ("ab", "c") and ("a", "bc") differ
+	void add(const string& text)
+	{
+		add((uint64_t)text.size());
+		add(text.data(), text.size());
+	}
+
+	template <typename T>
+	void add(T value)
+	{
+		static_assert(is_arithmetic<T>::value, "Only plain numbers are hashed by value");
+		add(&value, sizeof(value));
+	}
+
+	uint64_t get() const
+	{
+		return hash;
+	}
+};
+
+//Write a whole file through a uniquely named temporary next to it, flushed to disk and renamed over
+//the target, so a crash leaves either the old file or the new one and never a torn mix
+bool writeFileAtomically(const string& path, const void* data, size_t size, string& error);
+
+
+//Class describing a strategy as data: a finite-state machine whose transitions are driven by the
+//joint move of each round, (myMove << 1) | opponentMove with 1 = defect. Every state has a
+//probability of cooperating, so memory-n lookup tables, machines such as Grim, and probabilistic
+//strategies all run through the same kernel.
+class StrategyTable
+{
+private:
+	string name;
+	vector<uint64_t> threshold; //Per state: cooperate when a 32-bit draw is below this (0 .. 2^32)
+	vector<uint32_t> next;      //next[4 * state + jointMove]
+	uint32_t initialState;
+	bool deterministic;
+
+	static constexpr uint64_t always = 1ULL << 32;
+	static constexpr uint64_t half = 1ULL << 31;
+
+	//Most states a machine read by parse() may have
+	static constexpr uint32_t maxStates = 65536;
+
+	//Store a cooperation probability for a state
+	void setProbability(uint32_t state, double probability)
+	{
+		threshold[state] = (uint64_t)llround(min(1.0, max(0.0, probability)) * (double)always);
+
+		if (threshold[state] != 0 && threshold[state] != always)
+		{
+			deterministic = false;
+		}
+	}
+
+public:
+	//Default Constructor
+	StrategyTable()
+	{
+		initialState = 0;
+		deterministic = true;
+	}
+
+	string getName() const
+	{
+		return name;
+	}
+
+	uint32_t getNumOfStates() const
+	{
+		return (uint32_t)threshold.size();
+	}
+
+	uint32_t getInitialState() const
+	{
+		return initialState;
+	}
+
+	bool isDeterministic() const
+	{
+		return deterministic;
+	}
+
+	//Probability of cooperating in a state, exactly as move() draws it
+	double getCooperation(uint32_t state) const
+	{
+		return (double)threshold[state] / (double)always;
+	}
+
+	//Move in a state (0 = cooperate, 1 = defect). Only probabilistic states draw from the stream;
+	//a probability of exactly 1/2 draws a single bit, as the built-in Random strategy does.
+	int move(uint32_t state, RandomStream& random) const
+	{
+		uint64_t t = threshold[state];
+
+		if (t == always || t == 0)
+		{
+			return t == 0;
+		}
+
+		if (t == half)
+		{
+			return random.nextBit();
+		}
+
+		return random.next32() >= t;
+	}
+
+	uint32_t nextState(uint32_t state, int jointMove) const
+	{
+		return next[4 * state + jointMove];
+	}
+
+	//Hash the behaviour of the table (not its name): two tables that play alike hash alike
+	void addTo(Fingerprint& hash) const
+	{
+		hash.add(getNumOfStates());
+		hash.add(initialState);
+
+		for (uint32_t state = 0; state < getNumOfStates(); state++)
+		{
+			hash.add(getCooperation(state));
+
+			for (int jointMove = 0; jointMove < 4; jointMove++)
+			{
+				hash.add(nextState(state, jointMove));
+			}
+		}
+	}
+
+	//Memory-n strategy: the state is the last n joint moves (most recent in the low two bits) and
+	//cooperate[state] is the probability of cooperating after that history. startHistory is the
+	//history assumed before the first round.
+	static StrategyTable fromMemory(string name, int n, const vector<double>& cooperate, uint32_t startHistory)
+	{
+		StrategyTable table;
+		uint32_t states = 1u << (2 * n);
+
+		table.name = name;
+		table.threshold.assign(states, 0);
+		table.next.assign(4 * states, 0);
+		table.initialState = startHistory & (states - 1);
+
+		for (uint32_t state = 0; state < states; state++)
+		{
+			table.setProbability(state, cooperate[state]);
+
+			for (int joint = 0; joint < 4; joint++)
+			{
+				table.next[4 * state + joint] = ((state << 2) | joint) & (states - 1);
+			}
+		}
+
+		return table;
+	}
+
+	//General machine: cooperate[s] is state s's probability of cooperating and
+	//transitions[4 * s + jointMove] the state after the round
+	static StrategyTable fromMachine(string name, const vector<double>& cooperate, const vector<uint32_t>& transitions, uint32_t start)
+	{
+		StrategyTable table;
+
+		table.name = name;
+		table.threshold.assign(cooperate.size(), 0);
+		table.next = transitions;
+		table.initialState = start;
+
+		for (uint32_t state = 0; state < cooperate.size(); state++)
+		{
+			table.setProbability(state, cooperate[state]);
+		}
+
+		return table;
+	}
+
+	//Parse one strategy from a line of the form
+	//   NAME memory N P(0) .. P(4^N - 1) [start HISTORY]
+	//   NAME fsm S START  P(0) NEXT_CC NEXT_CD NEXT_DC NEXT_DD  ..  (S groups)
+	//where P are cooperation probabilities. Returns false with a message on malformed input.
+	static bool parse(const string& line, StrategyTable& table, string& error)
+	{
+		istringstream fields(line);
+		string tableName, kind;
+		fields >> tableName >> kind;
+
+		if (kind == "memory")
+		{
+			int n = -1;
+			fields >> n;
+
+			if (!fields || n < 0 || n > 6)
+			{
+				error = "memory depth must be between 0 and 6";
+				return false;
+			}
+
+			vector<double> cooperate(1u << (2 * n));
+			for (double& probability : cooperate)
+			{
+				fields >> probability;
+			}
+
+			if (!fields)
+			{
+				error = "expected " + to_string(cooperate.size()) + " probabilities";
+				return false;
+			}
+
+			uint32_t start = 0;
+			string keyword;
+			if (fields >> keyword)
+			{
+				if (keyword != "start" || !(fields >> start))
+				{
+					error = "expected 'start HISTORY' after the probabilities";
+					return false;
+				}
+			}
+
+			table = fromMemory(tableName, n, cooperate, start);
+			return true;
+		}
+
+		if (kind == "fsm")
+		{
+			uint32_t states = 0, start = 0;
+			fields >> states >> start;
+
+			if (!fields || states == 0 || states > maxStates || start >= states)
+			{
+				error = "expected a state count between 1 and " + to_string(maxStates) + " and a valid start state";
+				return false;
+			}
+
+			vector<double> cooperate(states);
+			vector<uint32_t> transitions(4 * (size_t)states);
+
+			for (uint32_t state = 0; state < states; state++)
+			{
+				fields >> cooperate[state];
+
+				for (size_t joint = 0; joint < 4; joint++)
+				{
+					fields >> transitions[4 * (size_t)state + joint];
+
+					if (fields && transitions[4 * (size_t)state + joint] >= states)
+					{
+						error = "transition to a state that does not exist";
+						return false;
+					}
+				}
+			}
+
+			if (!fields)
+			{
+				error = "expected " + to_string(states) + " groups of a probability and four next states";
+				return false;
+			}
+
+			table = fromMachine(tableName, cooperate, transitions, start);
+			return true;
+		}
+
+		error = "unknown kind '" + kind + "' (expected memory or fsm)";
+		return false;
+	}
+};
+
+
+//Class holding the named table strategies: the standard ones plus any loaded from data files
+class StrategyLibrary
+{
+private:
+	vector<shared_ptr<const StrategyTable>> tables;
+
+public:
+	//Default Constructor: the standard strategies
+	StrategyLibrary()
+	{
+		//Memory-one tables are indexed by the last joint move CC, CD, DC, DD
+		add(StrategyTable::fromMemory("ALLC", 0, { 1 }, 0));
+		add(StrategyTable::fromMemory("ALLD", 0, { 0 }, 0));
+		add(StrategyTable::fromMemory("Random", 0, { 0.5 }, 0));
+		add(StrategyTable::fromMemory("TFT", 1, { 1, 0, 1, 0 }, 0));
+		add(StrategyTable::fromMemory("STFT", 1, { 1, 0, 1, 0 }, 1)); //Suspicious: opens with a defection
+		add(StrategyTable::fromMemory("WSLS", 1, { 1, 0, 0, 1 }, 0)); //Win-stay lose-shift (Pavlov)
+		add(StrategyTable::fromMemory("Pavlov", 1, { 1, 0, 0, 1 }, 0));
+		add(StrategyTable::fromMemory("GTFT", 1, { 1, 1.0 / 3, 1, 1.0 / 3 }, 0)); //Generous tit for tat
+
+		//Tit for two tats: defect only after two defections in a row (memory two, CD or DD twice)
+		vector<double> tf2t(16);
+		for (uint32_t history = 0; history < 16; history++)
+		{
+			bool lastDefected = (history & 1) != 0;
+			bool previousDefected = (history & 4) != 0;
+			tf2t[history] = (lastDefected && previousDefected) ? 0 : 1;
+		}
+		add(StrategyTable::fromMemory("TF2T", 2, tf2t, 0));
+
+		//Grim trigger: cooperate until the opponent defects once, then defect forever
+		add(StrategyTable::fromMachine("Grim", { 1, 0 }, { 0, 1, 0, 1, 1, 1, 1, 1 }, 0));
+	}
+
+	void add(const StrategyTable& table)
+	{
+		tables.push_back(make_shared<const StrategyTable>(table));
+	}
+
+	//Find a strategy by name, or nullptr
+	shared_ptr<const StrategyTable> find(const string& name) const
+	{
+		for (const shared_ptr<const StrategyTable>& table : tables)
+		{
+			if (table->getName() == name)
+			{
+				return table;
+			}
+		}
+
+		return nullptr;
+	}
+
+	//Load strategies from a file with one StrategyTable::parse line each ('#' starts a comment).
+	//The loaded strategies are appended to loaded as well as added to the library; on failure
+	//error describes the problem.
+	bool load(const string& path, vector<shared_ptr<const StrategyTable>>& loaded, string& error)
+	{
+		ifstream file(path);
+
+		if (!file)
+		{
+			error = "Cannot open strategy file '" + path + "'";
+			return false;
+		}
+
+		string line;
+		int lineNumber = 0;
+
+		while (getline(file, line))
+		{
+			lineNumber++;
+
+			size_t start = line.find_first_not_of(" \t\r");
+			if (start == string::npos || line[start] == '#')
+			{
+				continue;
+			}
+
+			StrategyTable table;
+			if (!StrategyTable::parse(line, table, error))
+			{
+				error += " on line " + to_string(lineNumber) + " of " + path;
+				return false;
+			}
+
+			add(table);
+			loaded.push_back(tables.back());
+		}
+
+		return true;
+	}
+
+	//Table equivalent of a built-in strategy code, so built-ins can meet table strategies
+	static const StrategyTable* builtin(char code, char firstMove)
+	{
+		static const StrategyTable tables[8] = {
+			StrategyTable::fromMemory("r", 0, { 0.5 }, 0),
+			StrategyTable::fromMemory("r", 0, { 0.5 }, 0),
+			StrategyTable::fromMemory("c", 0, { 1 }, 0),
+			StrategyTable::fromMemory("c", 0, { 1 }, 0),
+			StrategyTable::fromMemory("e", 0, { 0 }, 0),
+			StrategyTable::fromMemory("e", 0, { 0 }, 0),
+			StrategyTable::fromMemory("t", 1, { 1, 0, 1, 0 }, 0),
+			StrategyTable::fromMemory("t", 1, { 1, 0, 1, 0 }, 1) //Tit for tat opening with a defection
+		};
+
+		int firstDefects = (firstMove == 'd') ? 1 : 0;
+
+		switch (code)
+		{
+			case 'r': return &tables[0 + firstDefects];
+			case 'c': return &tables[2 + firstDefects];
+			case 'e': return &tables[4 + firstDefects];
+			case 't': return &tables[6 + firstDefects];
+			default: return nullptr;
+		}
+	}
+};
+
+
+//Payoffs of the game, one table per side indexed by the joint move (move << 1) | opponentMove
+//with 1 = defect, so each table is { R, S, T, P }. Side 0 is the row player: entrant A of a
+//match, or the later player of a pairing in Game::simulate. Symmetric games use the same table twice.
+struct PayoffMatrix
+{
+	int32_t table[2][4];
+
+	//Score a side receives for the joint move of a round
+	int32_t get(int side, int move, int opponentMove) const
+	{
+		return table[side][(move << 1) | opponentMove];
+	}
+
+	//Total score of a side over rounds counted by joint move from side A's point of view
+	//(cd: A cooperated and B defected), so whole blocks of rounds are scored without branching
+	long long total(int side, long long cc, long long cd, long long dc, long long dd) const
+	{
+		const int32_t* payoff = table[side];
+
+		return (side == 0)
+			? cc * payoff[0] + cd * payoff[1] + dc * payoff[2] + dd * payoff[3]
+			: cc * payoff[0] + dc * payoff[1] + cd * payoff[2] + dd * payoff[3];
+	}
+
+	bool isSymmetric() const
+	{
+		return memcmp(table[0], table[1], sizeof(table[0])) == 0;
+	}
+
+	//Check that both sides play a Prisoner's Dilemma: T > R > P > S, and 2R > T + S so that
+	//alternating exploitation does not beat mutual cooperation. On failure error says why.
+	bool validate(string& error) const
+	{
+		for (int side = 0; side < 2; side++)
+		{
+			int32_t r = table[side][0], s = table[side][1], t = table[side][2], p = table[side][3];
+			string which = isSymmetric() ? "" : (side == 0 ? " for the row player" : " for the column player");
+
+			if (!(t > r && r > p && p > s))
+			{
+				error = "payoffs must satisfy T > R > P > S" + which;
+				return false;
+			}
+
+			if (!(2LL * r > (long long)t + s))
+			{
+				error = "payoffs must satisfy 2R > T + S" + which;
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	//Parse "R,S,T,P" for a symmetric game or "R,S,T,P/R,S,T,P" for the row and column players,
+	//then validate the result. Returns false with a message on malformed or invalid input.
+	static bool parse(const string& text, PayoffMatrix& matrix, string& error)
+	{
+		string spec = text;
+		replace(spec.begin(), spec.end(), ',', ' ');
+		size_t slash = spec.find('/');
+
+		for (int side = 0; side < 2; side++)
+		{
+			string part = (slash == string::npos) ? spec : (side == 0 ? spec.substr(0, slash) : spec.substr(slash + 1));
+			istringstream fields(part);
+			string extra;
+
+			for (int32_t& payoff : matrix.table[side])
+			{
+				fields >> payoff;
+			}
+
+			if (!fields || (fields >> extra))
+			{
+				error = "payoffs must be given as R,S,T,P or R,S,T,P/R,S,T,P, got '" + text + "'";
+				return false;
+			}
+		}
+
+		return matrix.validate(error);
+	}
+
+	//Load a matrix from a file holding one parse() specification ('#' starts a comment; the
+	//numbers may be spread over lines, with '/' before the column player's table)
+	static bool load(const string& path, PayoffMatrix& matrix, string& error)
+	{
+		ifstream file(path);
+
+		if (!file)
+		{
+			error = "Cannot open payoff file '" + path + "'";
+			return false;
+		}
+
+		string line, spec;
+
+		while (getline(file, line))
+		{
+			line = line.substr(0, line.find('#'));
+			spec += line + ' ';
+		}
+
+		if (!parse(spec, matrix, error))
+		{
+			error += " in " + path;
+			return false;
+		}
+
+		return true;
+	}
+};
+
+//The usual Prisoner's Dilemma: R = 3, S = 0, T = 5, P = 1 for both players
+constexpr PayoffMatrix defaultPayoffs = { { { 3, 0, 5, 1 }, { 3, 0, 5, 1 } } };
+
+//Payoffs every match, game and trace is scored with. Change it through setPayoffs before
+//starting a run, never while matches are being played.
+extern PayoffMatrix payoffs;
+
+//Replace the active payoffs after validating them; false (changing nothing) if they are invalid
+bool setPayoffs(const PayoffMatrix& matrix, string& error);
+
+//Score a player receives for their move against the opponent's move, as the given side
+int getPayoff(int side, char move, char opponentMove);
+
+
+
+//Scores of the two entrants after a single match
+struct MatchResult
+{
+	long long scoreA = 0;
+	long long scoreB = 0;
+};
+
+
+//Everything needed to play one match between two entrants
+struct MatchConfig
+{
+	char strategyA = 'r';
+	char strategyB = 'r';
+	char firstMoveA = 'c'; //First move of tit for tat, ignored by other strategies
+	char firstMoveB = 'c';
+	long long rounds = 0;
+	uint64_t seed = 0;     //Random moves come from the streams of (seed, matchID, idA/idB)
+	uint64_t matchID = 0;
+	uint64_t idA = 0;
+	uint64_t idB = 0;
+	const StrategyTable* tableA = nullptr; //Table strategies replace the strategy codes when set
+	const StrategyTable* tableB = nullptr;
+	double noiseA = 0;     //Probability that a move of each side is flipped (implementation noise)
+	double noiseB = 0;
+};
+
+
+//A strategy as chosen for an entrant: a built-in code (with tit for tat's first move) or a table
+struct StrategySpec
+{
+	string name;
+	char code = 'r';
+	char firstMove = 'c';
+	shared_ptr<const StrategyTable> table;
+	double noise = 0; //Probability that a move is flipped
+};
+
+//Fill in the strategies of both sides of a match
+void setMatchStrategies(MatchConfig& config, const StrategySpec& a, const StrategySpec& b);
+
+//Play a match between two table strategies, optionally fast-forwarding deterministic cycles
+MatchResult runTableKernel(const StrategyTable& a, const StrategyTable& b, const MatchConfig& config, bool fastForward);
+
+//Play a match in which at least one side is a table strategy
+MatchResult playTableMatch(const MatchConfig& config, bool fastForward);
+
+//Play a match move by move; the reference the specialised kernels must agree with
+MatchResult playMatchGeneric(const MatchConfig& config);
+
+//Play a match on the specialised kernel of its strategy pair. This is the engine's entry point
+//for a single match: it only computes, so it is safe to call from any thread.
+MatchResult playMatch(const MatchConfig& config);
+
+
+//One slot of an OutcomeCache. key 0 marks an empty slot.
+struct OutcomeEntry
+{
+	uint64_t key;   //Hash of the match, which also picks its home slot
+	uint64_t check; //Second hash of the match, to catch collisions of the first
+	int64_t scoreA;
+	int64_t scoreB;
+};
+
+//Layout of an outcome cache file: this header, then the slots exactly as held in memory. The table
+//is open-addressed with linear probing from slot key & (capacity - 1), so a reader can map the file
+//and probe it in place.
+struct OutcomeCacheHeader
+{
+	char magic[8];          //"IPDMEMO"
+	uint32_t version;
+	uint32_t engine;        //engineVersion of the program that wrote it
+	int32_t payoff[2][4];   //PayoffMatrix::table the outcomes were scored with
+	uint64_t capacity;      //Slots, a power of two
+	uint64_t numOfEntries;
+};
+
+static_assert(sizeof(OutcomeCacheHeader) == 64, "The outcome cache header must stay 64 bytes");
+
+
+//Class remembering match results by content. A match is keyed by the strategies' behaviour, the
+//rounds, the noise, the payoffs and engineVersion; random matches (a Random or probabilistic side,
+//or noise) also by the seed, match and player IDs their streams come from. Deterministic matches
+//leave those out, so every pairing of the same two strategies shares one entry. Safe to share
+//between threads.
+class OutcomeCache
+{
+private:
+	vector<OutcomeEntry> slots;
+	long long numOfEntries;
+	long long maxEntries; //No more are added once this many are held
+	long long hits, misses, loaded;
+	bool invalidated;     //A file was discarded because it came from other payoffs or engine
+	mutable mutex lock;
+
+	//Add the behaviour of one side of a match to a key
+	static void describe(Fingerprint& hash, char code, char firstMove, const StrategyTable* table)
+	{
+		if (table)
+		{
+			hash.add('*');
+			table->addTo(hash);
+			return;
+		}
+
+		//Only tit for tat looks at the first move
+		hash.add(code);
+		hash.add(code == 't' ? firstMove : 'c');
+	}
+
+	//Slot holding key, or the empty slot where it would go
+	size_t probe(uint64_t key) const
+	{
+		size_t mask = slots.size() - 1;
+		size_t slot = (size_t)key & mask;
+
+		while (slots[slot].key != 0 && slots[slot].key != key)
+		{
+			slot = (slot + 1) & mask;
+		}
+
+		return slot;
+	}
+
+	//Double the table, rehashing every entry
+	void grow()
+	{
+		vector<OutcomeEntry> old;
+		old.swap(slots);
+		slots.assign(old.size() * 2, OutcomeEntry());
+
+		for (const OutcomeEntry& entry : old)
+		{
+			if (entry.key != 0)
+			{
+				slots[probe(entry.key)] = entry;
+			}
+		}
+	}
+
+public:
+	//Most entries a cache holds; kept at most half full, its table never exceeds twice this
+	static constexpr long long entryLimit = 1LL << 21;
+	static constexpr long long maxCapacity = 2 * entryLimit;
+
+	//Default Constructor
+	OutcomeCache()
+	{
+		slots.assign(1024, OutcomeEntry());
+		numOfEntries = 0;
+		maxEntries = entryLimit;
+		hits = misses = loaded = 0;
+		invalidated = false;
+	}
+
+	void setMaxEntries(long long count)
+	{
+		maxEntries = min(entryLimit, max(1LL, count));
+	}
+
+	//Whether a match draws from its random streams at all
+	static bool isRandom(const MatchConfig& config)
+	{
+		bool randomA = config.tableA ? !config.tableA->isDeterministic() : config.strategyA == 'r';
+		bool randomB = config.tableB ? !config.tableB->isDeterministic() : config.strategyB == 'r';
+		return randomA || randomB || config.noiseA > 0 || config.noiseB > 0;
+	}
+
+	//Add everything that decides a match's result to a hash
+	static void addMatch(Fingerprint& hash, const MatchConfig& config)
+	{
+		hash.add(engineVersion);
+		hash.add(payoffs.table, sizeof(payoffs.table));
+		hash.add(config.rounds);
+		describe(hash, config.strategyA, config.firstMoveA, config.tableA);
+		describe(hash, config.strategyB, config.firstMoveB, config.tableB);
+		hash.add(config.noiseA);
+		hash.add(config.noiseB);
+
+		if (isRandom(config))
+		{
+			hash.add(config.seed);
+			hash.add(config.matchID);
+			hash.add(config.idA);
+			hash.add(config.idB);
+		}
+	}
+
+	//Key and check hash of a match: the same data hashed from two offset bases
+	static void keyOf(const MatchConfig& config, uint64_t& key, uint64_t& check)
+	{
+		Fingerprint first, second(0x6c62272e07bb0142ULL);
+		addMatch(first, config);
+		addMatch(second, config);
+		key = (first.get() == 0) ? 1 : first.get();
+		check = second.get();
+	}
+
+	//Result of a match if it is cached
+	bool lookup(const MatchConfig& config, MatchResult& result)
+	{
+		uint64_t key, check;
+		keyOf(config, key, check);
+
+		lock_guard<mutex> guard(lock);
+		const OutcomeEntry& entry = slots[probe(key)];
+
+		if (entry.key == key && entry.check == check)
+		{
+			result.scoreA = entry.scoreA;
+			result.scoreB = entry.scoreB;
+			hits++;
+			return true;
+		}
+
+		misses++;
+		return false;
+	}
+
+	//Remember the result of a match; ignored once the cache is full
+	void insert(const MatchConfig& config, const MatchResult& result)
+	{
+		uint64_t key, check;
+		keyOf(config, key, check);
+		insert({ key, check, result.scoreA, result.scoreB });
+	}
+
+	//Add an entry taken from another cache unless its key is already held or the cache is full
+	void insert(const OutcomeEntry& added)
+	{
+		lock_guard<mutex> guard(lock);
+		OutcomeEntry& entry = slots[probe(added.key)];
+
+		if (added.key == 0 || entry.key != 0 || numOfEntries >= maxEntries)
+		{
+			return;
+		}
+
+		entry = added;
+		numOfEntries++;
+
+		//Keep the load at most one half so probe sequences stay short
+		if (2 * numOfEntries > (long long)slots.size())
+		{
+			grow();
+		}
+	}
+
+	//Every entry held, in slot order
+	vector<OutcomeEntry> getEntries() const
+	{
+		lock_guard<mutex> guard(lock);
+		vector<OutcomeEntry> entries;
+		entries.reserve((size_t)numOfEntries);
+
+		for (const OutcomeEntry& entry : slots)
+		{
+			if (entry.key != 0)
+			{
+				entries.push_back(entry);
+			}
+		}
+
+		return entries;
+	}
+
+	//Count lookups made by another cache, such as a worker process's, as this one's
+	void addLookups(long long moreHits, long long moreMisses)
+	{
+		lock_guard<mutex> guard(lock);
+		hits += moreHits;
+		misses += moreMisses;
+	}
+
+	//Play a match unless its result is cached, caching it otherwise
+	MatchResult play(const MatchConfig& config, bool specialized = true)
+	{
+		MatchResult result;
+
+		if (!lookup(config, result))
+		{
+			result = specialized ? playMatch(config) : playMatchGeneric(config);
+			insert(config, result);
+		}
+
+		return result;
+	}
+
+	long long getNumOfHits()
+	{
+		lock_guard<mutex> guard(lock);
+		return hits;
+	}
+
+	long long getNumOfMisses()
+	{
+		lock_guard<mutex> guard(lock);
+		return misses;
+	}
+
+	long long getNumOfEntries()
+	{
+		lock_guard<mutex> guard(lock);
+		return numOfEntries;
+	}
+
+	//Entries read by load()
+	long long getNumOfLoaded()
+	{
+		return loaded;
+	}
+
+	//Whether load() discarded a file written under other payoffs or another engine version
+	bool wasInvalidated()
+	{
+		return invalidated;
+	}
+
+	//Read a cache file. A missing file is an empty cache, and one written under other payoffs or
+	//another engineVersion is discarded; only an unreadable or damaged file is an error.
+	bool load(const string& path, string& error);
+
+	//Write the cache to a file with writeFileAtomically
+	bool save(const string& path, string& error);
+};
+
+
+//How much of a game is logged: nothing, the round banners, or the banners and every move
+enum LogLevel
+{
+	LogOff,
+	LogRounds,
+	LogMoves
+};
+
+
+//Class writing log text to a file or stdout on a background thread. Producers hand over whole
+//chunks of text through a lock-free multi-producer queue (a linked list whose head is swapped
+//atomically), so a producer never waits for the output; the writer thread drains every chunk
+//available into one buffered stream and only flushes when it runs out of work. An idle writer
+//sleeps on a condition variable that a producer only signals when it finds the writer idle.
+class AsyncLog
+{
+private:
+	struct Chunk
+	{
+		atomic<Chunk*> next;
+		string text;
+	};
+
+	FILE* file;
+	bool ownsFile;
+	thread writer;
+	atomic<bool> stopping;
+	atomic<Chunk*> head;    //Most recently pushed chunk; producers swap themselves in here
+	Chunk* tail;            //Oldest chunk, already consumed; only the writer touches it
+	Chunk stub;
+	atomic<long long> bytesWritten;
+	atomic<long long> chunksWritten;
+	atomic<bool> idle;      //Set by the writer before it waits for work
+	mutex wakeMutex;
+	condition_variable wake;
+
+	//Take the oldest unconsumed chunk's text; false if the queue is empty
+	bool pop(string& text);
+
+	//Writer thread: drain the queue, waiting on wake whenever it is empty
+	void run();
+
+	//Wake the writer if it is waiting for work
+	void signal()
+	{
+		if (idle.load())
+		{
+			lock_guard<mutex> lock(wakeMutex);
+			idle.store(false);
+			wake.notify_one();
+		}
+	}
+
+	void start();
+
+public:
+	//Default Constructor
+	AsyncLog()
+	{
+		file = nullptr;
+		ownsFile = false;
+		stopping = false;
+		stub.next = nullptr;
+		head = &stub;
+		tail = &stub;
+		bytesWritten = 0;
+		chunksWritten = 0;
+		idle = false;
+	}
+
+	AsyncLog(const AsyncLog&) = delete;
+	AsyncLog& operator=(const AsyncLog&) = delete;
+
+	//Start writing to a file (truncated); false if it cannot be created
+	bool open(const string& path);
+
+	//Start writing to stdout
+	void openStdout();
+
+	//Queue a chunk of text; safe to call from any number of threads
+	void push(string&& text)
+	{
+		if (text.empty())
+		{
+			return;
+		}
+
+		Chunk* chunk = new Chunk;
+		chunk->next.store(nullptr, memory_order_relaxed);
+		chunk->text = move(text);
+
+		//Sequentially consistent with the writer's idle flag, so either it sees this chunk or we see it idle
+		Chunk* previous = head.exchange(chunk, memory_order_acq_rel);
+		previous->next.store(chunk);
+		signal();
+	}
+
+	//Write everything queued so far and stop the writer thread
+	void close();
+
+	bool isOpen() const
+	{
+		return file != nullptr;
+	}
+
+	long long getBytesWritten() const
+	{
+		return bytesWritten.load();
+	}
+
+	long long getChunksWritten() const
+	{
+		return chunksWritten.load();
+	}
+
+	//Destructor
+	~AsyncLog()
+	{
+		close();
+	}
+};
+
+
+//Stream buffer formatting into a private buffer that serves as its put area, so most characters
+//are stored without a virtual call. When the buffer fills up, every complete line in it is handed
+//to an AsyncLog as one chunk (so chunks from different threads never split a line) and the partial
+//line stays behind; a flush hands over everything. Give every producing thread its own AsyncLogStream.
+class AsyncLogBuffer : public streambuf
+{
+private:
+	AsyncLog* log;
+	unique_ptr<char[]> area;
+	size_t capacity;
+
+	//Hand over the first count bytes of the put area and move the rest of it to the front
+	void handOver(size_t count)
+	{
+		size_t used = (size_t)(pptr() - pbase());
+		log->push(string(area.get(), count));
+
+		memmove(area.get(), area.get() + count, used - count);
+		setp(area.get(), area.get() + capacity);
+		pbump((int)(used - count));
+	}
+
+protected:
+	int overflow(int c) override
+	{
+		size_t used = (size_t)(pptr() - pbase());
+		const char* lineEnd = nullptr;
+
+		for (const char* p = pptr(); p != pbase() && lineEnd == nullptr; p--)
+		{
+			lineEnd = (p[-1] == '\n') ? p : nullptr;
+		}
+
+		if (lineEnd != nullptr)
+		{
+			handOver((size_t)(lineEnd - pbase()));
+		}
+		else
+		{
+			//A single line longer than the buffer: let the buffer grow
+			unique_ptr<char[]> larger(new char[2 * capacity]);
+			memcpy(larger.get(), area.get(), used);
+			area = move(larger);
+			capacity *= 2;
+			setp(area.get(), area.get() + capacity);
+			pbump((int)used);
+		}
+
+		if (c != EOF)
+		{
+			*pptr() = (char)c;
+			pbump(1);
+		}
+
+		return (c == EOF) ? 0 : c;
+	}
+
+	int sync() override
+	{
+		if (pptr() != pbase())
+		{
+			handOver((size_t)(pptr() - pbase()));
+		}
+
+		return 0;
+	}
+
+public:
+	AsyncLogBuffer(AsyncLog& target, size_t chunkBytes)
+	{
+		log = &target;
+		capacity = max<size_t>(chunkBytes, 1);
+		area.reset(new char[capacity]);
+		setp(area.get(), area.get() + capacity);
+	}
+
+	//Destructor: hand over whatever is left
+	~AsyncLogBuffer()
+	{
+		sync();
+	}
+};
+
+
+//Output stream over an AsyncLogBuffer, usable wherever the engine takes an ostream
+class AsyncLogStream : public ostream
+{
+private:
+	AsyncLogBuffer buffer;
+
+public:
+	AsyncLogStream(AsyncLog& log, size_t chunkBytes = 64 * 1024) : ostream(nullptr), buffer(log, chunkBytes)
+	{
+		rdbuf(&buffer);
+	}
+};
+
+
+//Fixed-size header at the start of a match trace file. A trace stores the moves of one match
+//between sides A and B, then an index:
+//  moves: for every 64 rounds a pair of words (A, B), bit i = round 64w + i, 1 = defect
+//  index: for block b = 0 .. numOfBlocks, the totals (scoreA, scoreB, defectionsA, defectionsB)
+//         over the rounds before round b * blockRounds (the last entry covers the whole match)
+//A query jumps to its block through the index and popcounts at most one block of words.
+struct TraceHeader
+{
+	char magic[8];          //"IPDTRACE"
+	uint32_t version;
+	uint32_t blockRounds;   //Rounds per index block, a multiple of 64
+	uint64_t rounds;
+	uint64_t seed;
+	int32_t payoff[2][4];   //PayoffMatrix::table the scores were computed with
+	char nameA[20];         //Names of the two sides, zero padded
+	char nameB[20];
+	uint64_t movesOffset;   //Byte offsets of the two sections
+	uint64_t indexOffset;
+	uint64_t numOfBlocks;
+};
+
+static_assert(sizeof(TraceHeader) == 128, "The trace header must stay 128 bytes");
+
+
+//Class writing a match trace. Moves are packed into words as they are recorded and written
+//through a buffer; the index is accumulated on the way and appended by close(), which also
+//fills in the header.
+class TraceWriter
+{
+private:
+	ofstream file;
+	TraceHeader header;
+	vector<uint64_t> buffer;    //Move words waiting to be written
+	vector<int64_t> index;      //Four totals per block
+	uint64_t wordA, wordB;      //Moves of the current 64 rounds
+	int64_t totals[4];          //scoreA, scoreB, defectionsA, defectionsB so far
+
+	static constexpr size_t bufferWords = 8192;
+
+	void flushBuffer()
+	{
+		file.write((const char*)buffer.data(), (streamsize)(buffer.size() * sizeof(uint64_t)));
+		buffer.clear();
+	}
+
+public:
+	//Default Constructor
+	TraceWriter()
+	{
+		memset(&header, 0, sizeof(header));
+		wordA = wordB = 0;
+		memset(totals, 0, sizeof(totals));
+	}
+
+	//Start a trace; false if the file cannot be created. blockRounds is rounded up to a multiple of 64.
+	bool open(const string& path, const string& nameA, const string& nameB, uint64_t seed, uint32_t blockRounds = 4096)
+	{
+		file.open(path, ios::binary | ios::trunc);
+
+		if (!file)
+		{
+			return false;
+		}
+
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, "IPDTRACE", 8);
+		header.version = 2;
+		header.blockRounds = max<uint32_t>(64, (blockRounds + 63) / 64 * 64);
+		header.seed = seed;
+		memcpy(header.payoff, payoffs.table, sizeof(header.payoff));
+		strncpy(header.nameA, nameA.c_str(), sizeof(header.nameA) - 1);
+		strncpy(header.nameB, nameB.c_str(), sizeof(header.nameB) - 1);
+		header.movesOffset = sizeof(TraceHeader);
+
+		wordA = wordB = 0;
+		memset(totals, 0, sizeof(totals));
+		buffer.clear();
+		index.clear();
+
+		//Placeholder, rewritten by close()
+		file.write((const char*)&header, sizeof(header));
+		return (bool)file;
+	}
+
+	bool isOpen() const
+	{
+		return file.is_open();
+	}
+
+	//Record one round (moves are 0 = cooperate, 1 = defect)
+	void record(int moveA, int moveB)
+	{
+		uint64_t round = header.rounds++;
+		int bit = (int)(round & 63);
+
+		if (round % header.blockRounds == 0)
+		{
+			index.insert(index.end(), totals, totals + 4);
+		}
+
+		wordA |= (uint64_t)moveA << bit;
+		wordB |= (uint64_t)moveB << bit;
+
+		totals[0] += payoffs.get(0, moveA, moveB);
+		totals[1] += payoffs.get(1, moveB, moveA);
+		totals[2] += moveA;
+		totals[3] += moveB;
+
+		if (bit == 63)
+		{
+			buffer.push_back(wordA);
+			buffer.push_back(wordB);
+			wordA = wordB = 0;
+
+			if (buffer.size() >= bufferWords)
+			{
+				flushBuffer();
+			}
+		}
+	}
+
+	//Write the last moves and the index and complete the header; false on a write error
+	bool close()
+	{
+		if (header.rounds & 63)
+		{
+			buffer.push_back(wordA);
+			buffer.push_back(wordB);
+		}
+
+		flushBuffer();
+
+		header.numOfBlocks = (header.rounds + header.blockRounds - 1) / header.blockRounds;
+		index.insert(index.end(), totals, totals + 4);
+		header.indexOffset = (uint64_t)file.tellp();
+		file.write((const char*)index.data(), (streamsize)(index.size() * sizeof(int64_t)));
+
+		file.seekp(0);
+		file.write((const char*)&header, sizeof(header));
+
+		bool written = (bool)file;
+		file.close();
+		return written;
+	}
+};
+
+
+//Class answering queries on a match trace through a read-only memory mapping, so only the
+//pages a query touches are read from disk. Rounds are counted from 0; side 0 is A, 1 is B.
+class TraceReader
+{
+private:
+	const uint8_t* data;
+	uint64_t length;
+	const TraceHeader* header;
+	const uint64_t* moves;
+	const int64_t* index;
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#endif
+
+	//Totals (scoreA, scoreB, defectionsA, defectionsB) over the rounds before round k
+	void totalsBefore(uint64_t k, int64_t totals[4]) const
+	{
+		uint64_t block = k / header->blockRounds;
+		memcpy(totals, &index[4 * block], 4 * sizeof(int64_t));
+
+		PayoffMatrix matrix;
+		memcpy(matrix.table, header->payoff, sizeof(matrix.table));
+
+		for (uint64_t w = block * header->blockRounds / 64; w * 64 < k; w++)
+		{
+			uint64_t valid = (k - w * 64 >= 64) ? ~0ULL : ((1ULL << (k - w * 64)) - 1);
+			uint64_t a = moves[2 * w] & valid, b = moves[2 * w + 1] & valid;
+
+			int64_t cc = countBits(~a & ~b & valid), cd = countBits(~a & b & valid);
+			int64_t dc = countBits(a & ~b), dd = countBits(a & b);
+
+			totals[0] += matrix.total(0, cc, cd, dc, dd);
+			totals[1] += matrix.total(1, cc, cd, dc, dd);
+			totals[2] += dc + dd;
+			totals[3] += cd + dd;
+		}
+	}
+
+public:
+	//Default Constructor
+	TraceReader()
+	{
+		data = nullptr;
+		length = 0;
+		header = nullptr;
+		moves = nullptr;
+		index = nullptr;
+#ifdef _WIN32
+		fileHandle = nullptr;
+		mappingHandle = nullptr;
+#endif
+	}
+
+	TraceReader(const TraceReader&) = delete;
+	TraceReader& operator=(const TraceReader&) = delete;
+
+	//Map a trace file; on failure error describes the problem
+	bool open(const string& path, string& error);
+
+	//Unmap the trace
+	void close();
+
+	//Destructor
+	~TraceReader()
+	{
+		close();
+	}
+
+	const TraceHeader& getHeader() const
+	{
+		return *header;
+	}
+
+	long long getNumOfRounds() const
+	{
+		return (long long)header->rounds;
+	}
+
+	//Move of a side in a round (0 = cooperate, 1 = defect)
+	int getMove(int side, long long round) const
+	{
+		return (int)((moves[2 * (round >> 6) + side] >> (round & 63)) & 1);
+	}
+
+	//Score of a side after the first k rounds
+	long long scoreAfter(int side, long long k) const
+	{
+		int64_t totals[4];
+		totalsBefore((uint64_t)min(max(k, 0LL), getNumOfRounds()), totals);
+		return totals[side];
+	}
+
+	//Number of defections of a side in rounds [first, last)
+	long long countDefections(int side, long long first, long long last) const
+	{
+		int64_t before[4], after[4];
+		totalsBefore((uint64_t)max(first, 0LL), before);
+		totalsBefore((uint64_t)min(last, getNumOfRounds()), after);
+		return after[2 + side] - before[2 + side];
+	}
+
+	//Round of a side's first defection, or -1 if they never defect
+	long long firstDefection(int side) const
+	{
+		uint64_t numOfBlocks = header->numOfBlocks;
+
+		for (uint64_t block = 0; block < numOfBlocks; block++)
+		{
+			//The index tells which block holds the first defection without touching the moves
+			if (index[4 * (block + 1) + 2 + side] == index[4 * block + 2 + side])
+			{
+				continue;
+			}
+
+			for (uint64_t w = block * header->blockRounds / 64; w * 64 < header->rounds; w++)
+			{
+				uint64_t word = moves[2 * w + side];
+
+				if (word != 0)
+				{
+					return (long long)(w * 64 + lowestBit(word));
+				}
+			}
+		}
+
+		return -1;
+	}
+
+	//Share of cooperations of a side in each window of consecutive rounds (the last may be shorter)
+	vector<double> cooperationRates(int side, long long window) const
+	{
+		vector<double> rates;
+
+		for (long long first = 0; first < getNumOfRounds(); first += window)
+		{
+			long long last = min(first + window, getNumOfRounds());
+			rates.push_back(1.0 - (double)countDefections(side, first, last) / (double)(last - first));
+		}
+
+		return rates;
+	}
+};
+
+
+//Class representing the game and its operations.
+class Game
+{
+private:
+	//Players are kept in order in a vector, with their scores alongside so the round loop adds
+	//to contiguous memory. The order matters because it decides which player of a pair is the
+	//row player, so a drop erases in place rather than swapping the last player in.
+	vector<Player> players;   //Strategy, move history and noise stream of each player
+	vector<long long> scores; //Score of each player, accumulated by simulate()
+	int numOfPlayers;
+	int numOfRounds;
+	char strategy;
+	ostream* log; //Receives every move and round banner while playing; nullptr for a silent game
+	LogLevel logLevel; //How much of the game is written to log
+	TraceWriter* trace; //Records the moves of a two-player game; nullptr for none
+	uint64_t seed; //Global seed of the players' random streams
+	bool useKernels; //Play silent two-player games as one match through playMatch
+	OutcomeCache* cache; //Consulted by that shortcut before playing; nullptr for none
+
+	//Add a new player after the others
+	void appendPlayer()
+	{
+		players.emplace_back();
+		scores.push_back(0);
+		numOfPlayers++;
+	}
+
+	//Position of the player with the given ID, or -1 if it is not in the game
+	int indexOf(int playerID)
+	{
+		for (int i = 0; i < numOfPlayers; i++)
+		{
+			if (players[i].getID() == playerID)
+			{
+				return i;
+			}
+		}
+
+		return -1;
+	}
+
+	//Copy the dense scores back into the player objects
+	void publishScores()
+	{
+		for (int i = 0; i < numOfPlayers; i++)
+		{
+			players[i].setScore(scores[i]);
+		}
+	}
+
+public:
+
+	//Default Constructor
+	Game()
+	{
+		numOfPlayers = 0;
+		numOfRounds = 0;
+		log = nullptr;
+		logLevel = LogMoves;
+		trace = nullptr;
+		seed = 0;
+		useKernels = true;
+		cache = nullptr;
+	}
+
+	//Allow or forbid the match-kernel shortcut for silent two-player games
+	void setUseKernels(bool allow)
+	{
+		useKernels = allow;
+	}
+
+	//Look silent two-player games up in a cache of match outcomes, or stop with nullptr
+	void setOutcomeCache(OutcomeCache* outcomes)
+	{
+		cache = outcomes;
+	}
+
+	//Set the global random seed; the game is match 0 of that seed
+	void setSeed(uint64_t newSeed)
+	{
+		seed = newSeed;
+
+		for (int i = 0; i < numOfPlayers; i++)
+		{
+			players[i].seedRandom(seed, 0);
+		}
+	}
+
+	//Send the per-round output to a stream (an AsyncLogStream keeps the game from waiting on the
+	//console), or turn it off with nullptr
+	void setLog(ostream* out, LogLevel level = LogMoves)
+	{
+		log = out;
+		logLevel = level;
+	}
+
+	//Record the moves of a two-player game to an open trace (side A is player 2, as in the
+	//match kernels), or stop recording with nullptr
+	void setTrace(TraceWriter* writer)
+	{
+		trace = writer;
+	}
+
+	//Set the number of rounds and allocate memory for each player's moves
+	void setNumberOfRounds(int rounds)
+	{
+		IPD_TIME_SCOPE(PhaseHistory);
+		numOfRounds = rounds;
+		
+		//Allocate memory for each player's moves
+		for (int i = 0; i < numOfPlayers; i++)
+		{	
+			// Reset player-specific data
+			players[i].resetData();
+			scores[i] = 0;
+
+			// Set the number of moves for each player based on the specified rounds
+			players[i].setNumberOfMoves(rounds);
+
+			// Restart the player's random stream so a seeded game is reproducible
+			players[i].seedRandom(seed, 0);
+		}
+
+		configureHistory();
+	}
+
+	//Keep only as much history per player as the game and the chosen strategies look back over,
+	//so memory does not grow with the number of rounds
+	void configureHistory()
+	{
+		IPD_TIME_SCOPE(PhaseHistory);
+		int depth = 1; //The game itself hands each player's last move to the opponent
+
+		for (int i = 0; i < numOfPlayers; i++)
+		{
+			depth = max(depth, players[i].getHistoryDepth());
+		}
+
+		//Moves against every opponent are interleaved in a player's history
+		for (int i = 0; i < numOfPlayers; i++)
+		{
+			players[i].setHistoryWindow((long long)depth * max(1, numOfPlayers - 1));
+		}
+	}
+
+
+	//Display the result of the game
+	void displayResult(ostream& out)
+	{
+		int winnerID = -1;
+		long long highestScore = -1;
+		int* tiedPlayers = new int[numOfPlayers];  //Dynamic array to store IDs of tied players
+		int numTiedPlayers = 0;
+		string winner;
+
+		out << endl;
+		out << "*********************************" << endl;
+		out << endl;
+
+		for (int i = 0; i < numOfPlayers; i++)
+		{
+			//Display player information
+			out << "Player ID: " << players[i].getID() << endl;
+			out << "Name: " << players[i].getName() << endl;
+			out << "Score: " << scores[i] << endl;
+			out << endl;
+			
+			//Check for the winner
+			if (scores[i] > highestScore)
+			{
+				//Reset tied player count if a new highest score is found
+				numTiedPlayers = 0;  
+				tiedPlayers[numTiedPlayers++] = players[i].getID();
+				winnerID = players[i].getID();
+				winner = players[i].getName();
+				highestScore = scores[i];
+			}
+
+			else if (scores[i] == highestScore)
+			{
+				if (numTiedPlayers == 0)  //Allocate memory only if it's the first tie
+					tiedPlayers = new int[numOfPlayers];
+
+				//Store the ID of a tied player
+				tiedPlayers[numTiedPlayers++] = players[i].getID();
+			}
+
+		}
+
+		out << "*********************************" << endl;
+		out << endl;
+
+		//Display Result
+		out << "------------------------------------" << endl;
+		out << "|              RESULT              |" << endl;
+		out << "------------------------------------" << endl;
+
+		//Check if there is a single winner or a tie
+		if (numTiedPlayers == 1)
+		{
+			//Display information for a single winner
+			out << "|WinnerID: " << winnerID << "                       |" << endl;
+			out << "|Name: " << winner << "                           |" << endl;
+			out << "|Score: " << highestScore << "                         |" << endl;
+		}
+
+		else
+		{
+			//Display information for a tie
+			out << "|It's a tie                        |" << endl;
+			out << "|                                  |" << endl;
+			out << "|Tied Players:                     |" << endl;
+
+			for (int i = 0; i < numTiedPlayers; i++)
+			{
+
+				out << "|Player " << tiedPlayers[i] << "                          |" << endl;
+			}
+
+			out << "|                                  |" << endl;
+
+			out << "|Score of each player: " << highestScore << "          |" << endl;
+		}
+
+		out << "------------------------------------" << endl;
+
+		out << endl;
+
+		//Deallocate memory for tiedPlayers array
+		delete[] tiedPlayers;
+	}
+
+	//Display a compact one-line-per-player summary of the game
+	void displaySummary(ostream& out)
+	{
+		long long highestScore = -1;
+
+		for (int i = 0; i < numOfPlayers; i++)
+		{
+			if (scores[i] > highestScore)
+			{
+				highestScore = scores[i];
+			}
+		}
+
+		out << "rounds=" << numOfRounds << " players=" << numOfPlayers << '\n';
+
+		for (int i = 0; i < numOfPlayers; i++)
+		{
+			out << "id=" << players[i].getID()
+				<< " name=" << players[i].getName()
+				<< " strategy=" << players[i].getStrategy()
+				<< " score=" << scores[i]
+				<< (scores[i] == highestScore ? " winner" : "") << '\n';
+		}
+	}
+
+	//Create a fresh set of unnamed players, releasing any existing ones
+	void createPlayers(int numPlayers)
+	{
+		generateID::resetID();
+		Player::resetNumOfPlayers();
+
+		players.clear();
+		scores.clear();
+		numOfPlayers = 0;
+
+		players.reserve(numPlayers);
+
+		for (int i = 0; i < numPlayers; i++)
+		{
+			appendPlayer();
+		}
+	}
+
+	//Grow the game by numOfPlayersToAdd unnamed players, keeping the existing ones (with their
+	//scores reset). Returns false, changing nothing, when that would exceed Max_Players.
+	bool addPlayersToExistingGame(int numOfPlayersToAdd)
+	{
+		//Check if the total number of players after adding new players is within the allowable limit
+		if ((numOfPlayers + numOfPlayersToAdd) > Max_Players)
+		{
+			return false;
+		}
+
+		for (int i = 0; i < numOfPlayers; i++)
+		{
+			players[i].resetData();
+			scores[i] = 0;
+		}
+
+		for (int i = 0; i < numOfPlayersToAdd; i++)
+		{
+			appendPlayer();
+		}
+
+		Player::setNumOfPlayers(numOfPlayers);
+		return true;
+	}
+
+	//Drop a player from the game; false if no player has that ID. The later players move up one
+	//place, keeping their order.
+	bool dropPlayer(int playerID)
+	{
+		int index = indexOf(playerID);
+
+		if (index < 0)
+		{
+			return false;
+		}
+
+		players.erase(players.begin() + index);
+		scores.erase(scores.begin() + index);
+		numOfPlayers--;
+
+		Player::setNumOfPlayers(numOfPlayers);
+		return true;
+	}
+
+	//Player with the given ID, or nullptr if it is not in the game
+	Player* getPlayer(int playerID)
+	{
+		int index = indexOf(playerID);
+		return (index < 0) ? nullptr : &players[index];
+	}
+
+
+	//Get information about the players
+	Player* getPlayerInfo() {
+		return players.data();
+	}
+
+	int getNumOfPlayers()
+	{
+		return numOfPlayers;
+	}
+
+	//Run every round of the game without displaying the result
+	void simulate()
+	{
+		//Strategies may have changed since the rounds were set
+		configureHistory();
+
+		//A silent two-player game is exactly one match, so let the specialised kernels play it
+		//(and fast-forward deterministic pairings). Only the scores are updated, not the histories.
+		if (useKernels && log == nullptr && trace == nullptr && numOfPlayers == 2)
+		{
+			//The round loop below pairs j = 1 against k = 0
+			MatchConfig config;
+			config.strategyA = players[1].getStrategy();
+			config.strategyB = players[0].getStrategy();
+			config.firstMoveA = players[1].getFirstMove();
+			config.firstMoveB = players[0].getFirstMove();
+			config.rounds = numOfRounds;
+			config.seed = seed;
+			config.matchID = 0;
+			config.idA = (uint64_t)players[1].getID();
+			config.idB = (uint64_t)players[0].getID();
+			config.noiseA = players[1].getErrorRate();
+			config.noiseB = players[0].getErrorRate();
+
+			MatchResult result = cache ? cache->play(config) : playMatch(config);
+			scores[1] += result.scoreA;
+			scores[0] += result.scoreB;
+			publishScores();
+			return;
+		}
+
+		IPD_COUNT(CounterGameRounds, numOfRounds);
+
+		for (int i = 0; i < numOfRounds; i++)
+		{
+			for (int j = 0; j < numOfPlayers; j++)
+			{
+				int x = 0;
+
+				for (int k = 0; k < j; k++)
+				{
+					IPD_LAP_START(lap);
+
+					if (log != nullptr && logLevel >= LogRounds)
+					{
+						char banner[128] = "----------------------------------\n              Round ";
+						char* end = to_chars(banner + 55, banner + 70, i + 1).ptr;
+						const char* rest = "             \n----------------------------------\n\n";
+
+						memcpy(end, rest, strlen(rest));
+						log->write(banner, (end - banner) + (streamsize)strlen(rest));
+					}
+
+					IPD_LAP(lap, PhaseOutput);
+
+					//Stores Player Moves
+					char playerOne = 'c';
+					char playerTwo = 'c';
+
+					if (i == 0)
+					{
+						//There is no previous round, so tit for tat opens with the first move chosen for
+						//the player before the game (see Player::setFirstMove); the other strategies
+						//ignore the opponent's last move.
+						char defaultChar = 'c';
+
+						playerOne = players[j].makeMove(players[j].getStrategy() == 't' ? players[j].getFirstMove() : defaultChar);
+						playerTwo = players[k].makeMove(players[k].getStrategy() == 't' ? players[k].getFirstMove() : defaultChar);
+					}
+
+
+					else
+					{
+						int last_Move2 = players[k].getLastMove(x);
+						int last_Move1 = players[j].getLastMove(x);
+
+						playerOne = players[j].makeMove(last_Move2);
+						playerTwo = players[k].makeMove(last_Move1);
+					}
+
+					IPD_LAP(lap, PhaseDispatch);
+
+					if (log != nullptr && logLevel >= LogMoves)
+					{
+						players[j].printMoves(*log, playerOne);
+						players[k].printMoves(*log, playerTwo);
+					}
+
+					if (trace != nullptr && numOfPlayers == 2)
+					{
+						trace->record(playerOne == 'd', playerTwo == 'd');
+					}
+
+					IPD_LAP(lap, PhaseOutput);
+				
+					x = x + 1;
+
+					//Set Score based on moves: one table lookup per player, the later player being the row player
+					int moveOne = (playerOne == 'd');
+					int moveTwo = (playerTwo == 'd');
+
+					scores[j] += payoffs.get(0, moveOne, moveTwo);
+					scores[k] += payoffs.get(1, moveTwo, moveOne);
+
+					IPD_LAP(lap, PhaseScoring);
+
+				}
+			}
+
+
+		}
+
+		publishScores();
+	}
+
+};
+
+
+//Layout of a tournament checkpoint: this header, then one int64_t partial score per entrant
+struct CheckpointHeader
+{
+	char magic[8];          //"IPDCKPT"
+	uint32_t version;
+	uint32_t numOfEntrants;
+	uint64_t fingerprint;   //Tournament::fingerprint of the run that wrote it
+	uint64_t numOfPairings;
+	uint64_t nextPairing;   //Pairings [0, nextPairing) are complete and counted in the scores
+	uint64_t checksum;      //FNV-1a of the score array
+};
+
+static_assert(sizeof(CheckpointHeader) == 48, "The checkpoint header must stay 48 bytes");
+
+
+//Class running a round-robin tournament between any number of entrants across a pool of threads
+class Tournament
+{
+private:
+	vector<string> names;
+	vector<char> strategies;
+	vector<char> firstMoves;
+	vector<shared_ptr<const StrategyTable>> tables; //Table strategy of each entrant, or null for a built-in
+	vector<double> errorRates; //Probability that each entrant's moves are flipped
+	vector<long long> scores;
+	long long numOfRounds;
+	int numOfThreads;
+	long long numOfMatches;
+	uint64_t seed;
+	bool specialized; //Use the per-pair specialised kernels rather than the generic loop
+	string checkpointPath;     //Where progress is saved, or empty for none
+	double checkpointInterval; //Seconds between checkpoints
+	string checkpointError;    //First checkpoint write failure, if any
+	long long numOfCheckpoints;
+	long long firstPairing;    //Pairings before this were restored by resume()
+	bool resumed;
+	OutcomeCache* cache;       //Consulted before playing each match; nullptr for none
+
+	//Play one match, through the outcome cache if there is one
+	MatchResult playOne(const MatchConfig& config)
+	{
+		if (cache)
+		{
+			return cache->play(config, specialized);
+		}
+
+		return specialized ? playMatch(config) : playMatchGeneric(config);
+	}
+
+	//Number of pairings a worker claims at a time
+	static constexpr long long chunkSize = 64;
+
+	//Find the pairing (i, j) with i < j at position index of the row-major pairing list
+	void pairingAt(long long index, int& i, int& j)
+	{
+		int n = (int)names.size();
+		i = 0;
+
+		while (index >= n - 1 - i)
+		{
+			index -= n - 1 - i;
+			i++;
+		}
+
+		j = i + 1 + (int)index;
+	}
+
+	//Worker loop: claim chunks of the pairings before last and accumulate scores into a private array
+	void runWorker(atomic<long long>& nextPairing, long long last, vector<long long>& localScores)
+	{
+		int n = (int)names.size();
+		bool symmetric = payoffs.isSymmetric();
+
+		while (true)
+		{
+			long long start = nextPairing.fetch_add(chunkSize);
+			if (start >= last)
+			{
+				break;
+			}
+
+			long long end = min(start + chunkSize, last);
+			int i, j;
+			pairingAt(start, i, j);
+
+			for (long long p = start; p < end; p++)
+			{
+				MatchConfig config;
+				config.strategyA = strategies[i];
+				config.strategyB = strategies[j];
+				config.firstMoveA = firstMoves[i];
+				config.firstMoveB = firstMoves[j];
+				config.rounds = numOfRounds;
+				config.seed = seed;
+				config.matchID = (uint64_t)p;
+				config.idA = (uint64_t)i;
+				config.idB = (uint64_t)j;
+				config.tableA = tables[i].get();
+				config.tableB = tables[j].get();
+				config.noiseA = errorRates[i];
+				config.noiseB = errorRates[j];
+
+				MatchResult result = playOne(config);
+				localScores[i] += result.scoreA;
+				localScores[j] += result.scoreB;
+
+				//Under asymmetric payoffs the pair plays a second match with the roles swapped,
+				//so the lower-numbered entrant is not always the row player
+				if (!symmetric)
+				{
+					swap(config.strategyA, config.strategyB);
+					swap(config.firstMoveA, config.firstMoveB);
+					swap(config.idA, config.idB);
+					swap(config.tableA, config.tableB);
+					swap(config.noiseA, config.noiseB);
+					config.matchID = (uint64_t)(numOfMatches + p);
+
+					result = playOne(config);
+					localScores[j] += result.scoreA;
+					localScores[i] += result.scoreB;
+				}
+
+				//Step to the next pairing in row-major order
+				if (++j == n)
+				{
+					i++;
+					j = i + 1;
+				}
+			}
+		}
+	}
+
+	//Play pairings [begin, end) across the thread pool and add their scores to the totals
+	void runPairings(long long begin, long long end)
+	{
+		atomic<long long> nextPairing(begin);
+		vector<vector<long long>> workerScores(numOfThreads, vector<long long>(names.size(), 0));
+		vector<thread> workers;
+
+		for (int t = 1; t < numOfThreads; t++)
+		{
+			workers.emplace_back(&Tournament::runWorker, this, ref(nextPairing), end, ref(workerScores[t]));
+		}
+
+		//The calling thread works too
+		runWorker(nextPairing, end, workerScores[0]);
+
+		for (thread& worker : workers)
+		{
+			worker.join();
+		}
+
+		for (int t = 0; t < numOfThreads; t++)
+		{
+			for (size_t i = 0; i < names.size(); i++)
+			{
+				scores[i] += workerScores[t][i];
+			}
+		}
+	}
+
+	//Hash of everything that decides the scores. The thread count and the kernel choice are left
+	//out: neither changes a result, so a run may be resumed with different ones.
+	uint64_t fingerprint() const
+	{
+		Fingerprint hash;
+		hash.add(engineVersion);
+		hash.add((uint64_t)names.size());
+		hash.add(numOfRounds);
+		hash.add(seed);
+		hash.add(payoffs.table, sizeof(payoffs.table));
+
+		for (size_t i = 0; i < names.size(); i++)
+		{
+			hash.add(names[i]);
+			hash.add(strategies[i]);
+			hash.add(firstMoves[i]);
+			hash.add(errorRates[i]);
+
+			if (tables[i])
+			{
+				tables[i]->addTo(hash);
+			}
+		}
+
+		return hash.get();
+	}
+
+	//Save the totals of pairings [0, nextPairing). A failed write is remembered, not fatal: the
+	//tournament itself is unaffected and the previous checkpoint stays intact.
+	void writeCheckpoint(long long nextPairing)
+	{
+		vector<char> buffer(sizeof(CheckpointHeader) + scores.size() * sizeof(int64_t));
+		CheckpointHeader header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, "IPDCKPT", 7);
+		header.version = 1;
+		header.numOfEntrants = (uint32_t)names.size();
+		header.fingerprint = fingerprint();
+		header.numOfPairings = (uint64_t)numOfMatches;
+		header.nextPairing = (uint64_t)nextPairing;
+
+		Fingerprint checksum;
+		checksum.add(scores.data(), scores.size() * sizeof(int64_t));
+		header.checksum = checksum.get();
+
+		memcpy(buffer.data(), &header, sizeof(header));
+		memcpy(buffer.data() + sizeof(header), scores.data(), scores.size() * sizeof(int64_t));
+
+		string error;
+		if (writeFileAtomically(checkpointPath, buffer.data(), buffer.size(), error))
+		{
+			numOfCheckpoints++;
+		}
+		else if (checkpointError.empty())
+		{
+			checkpointError = error;
+		}
+	}
+
+public:
+	//Default Constructor
+	Tournament()
+	{
+		numOfRounds = 0;
+		numOfThreads = 1;
+		numOfMatches = 0;
+		seed = 0;
+		specialized = true;
+		checkpointInterval = 60;
+		numOfCheckpoints = 0;
+		firstPairing = 0;
+		resumed = false;
+		cache = nullptr;
+	}
+
+	//Look matches up in a cache of outcomes before playing them, or stop with nullptr
+	void setOutcomeCache(OutcomeCache* outcomes)
+	{
+		cache = outcomes;
+	}
+
+	void addEntrant(string name, char code, char firstMove)
+	{
+		names.push_back(name);
+		strategies.push_back(code);
+		firstMoves.push_back(firstMove);
+		tables.push_back(nullptr);
+		errorRates.push_back(0);
+	}
+
+	//Add an entrant playing a table strategy
+	void addEntrant(string name, shared_ptr<const StrategyTable> table)
+	{
+		names.push_back(name);
+		strategies.push_back('*');
+		firstMoves.push_back('c');
+		tables.push_back(table);
+		errorRates.push_back(0);
+	}
+
+	//Make an entrant's moves flip with the given probability
+	void setErrorRate(int entrant, double rate)
+	{
+		errorRates[entrant] = rate;
+	}
+
+	void setNumberOfRounds(long long rounds)
+	{
+		numOfRounds = rounds;
+	}
+
+	//Set the global random seed; match p uses the streams of (seed, p, entrant index)
+	void setSeed(uint64_t newSeed)
+	{
+		seed = newSeed;
+	}
+
+	//Choose between the specialised kernels and the generic Strategy::cooperateOrDefect loop
+	void setSpecializedKernels(bool useSpecialized)
+	{
+		specialized = useSpecialized;
+	}
+
+	void setNumberOfThreads(int threads)
+	{
+		numOfThreads = max(1, threads);
+	}
+
+	int getNumOfEntrants()
+	{
+		return (int)names.size();
+	}
+
+	//Matches played: one per pairing, or two under asymmetric payoffs
+	long long getNumOfMatches()
+	{
+		return payoffs.isSymmetric() ? numOfMatches : 2 * numOfMatches;
+	}
+
+	long long getScore(int entrant)
+	{
+		return scores[entrant];
+	}
+
+	string getEntrantName(int entrant)
+	{
+		return names[entrant];
+	}
+
+	//Name of an entrant's table strategy, or its built-in strategy code
+	string getEntrantStrategy(int entrant)
+	{
+		return tables[entrant] ? tables[entrant]->getName() : string(1, strategies[entrant]);
+	}
+
+	//Save progress to path every interval seconds while run() plays, and once more at the end
+	void setCheckpoint(const string& path, double intervalSeconds)
+	{
+		checkpointPath = path;
+		checkpointInterval = max(0.0, intervalSeconds);
+	}
+
+	//Restore the progress saved by a checkpoint of this same tournament; the next run() plays
+	//only the remaining pairings. Every match draws from its own streams, keyed by the seed and
+	//its pairing index, so nothing else is needed to finish bit-identically to an unbroken run.
+	bool resume(const string& path, string& error);
+
+	//Empty unless a checkpoint could not be written
+	string getCheckpointError()
+	{
+		return checkpointError;
+	}
+
+	long long getNumOfCheckpoints()
+	{
+		return numOfCheckpoints;
+	}
+
+	//Pairings restored from a checkpoint rather than played by the last run()
+	long long getNumOfResumedPairings()
+	{
+		return firstPairing;
+	}
+
+	//Pairings of the round-robin, numbered in row-major order; shards are ranges of these
+	long long getNumOfPairings()
+	{
+		long long n = (long long)names.size();
+		return n * (n - 1) / 2;
+	}
+
+	//Hash of the configuration, which every process sharing a tournament must agree on
+	uint64_t getFingerprint()
+	{
+		return fingerprint();
+	}
+
+	//Play only pairings [begin, end) and return what each entrant scored in them. A sharded run
+	//plays every pairing in exactly one shard and merges the results with addShardScores.
+	vector<long long> runShard(long long begin, long long end)
+	{
+		IPD_TIME_SCOPE(PhaseTournament);
+		numOfMatches = getNumOfPairings();
+		scores.assign(names.size(), 0);
+		runPairings(max(0LL, begin), min(end, numOfMatches));
+		return scores;
+	}
+
+	//Start the totals of a sharded run from zero
+	void clearScores()
+	{
+		numOfMatches = getNumOfPairings();
+		scores.assign(names.size(), 0);
+	}
+
+	//Add the result of one shard to the totals
+	void addShardScores(const vector<long long>& partial)
+	{
+		for (size_t i = 0; i < names.size(); i++)
+		{
+			scores[i] += partial[i];
+		}
+	}
+
+	//Play every pairing once. Each worker keeps its own score array, merged after all threads finish.
+	//With a checkpoint the pairings are played in segments, saving the totals between them.
+	void run()
+	{
+		IPD_TIME_SCOPE(PhaseTournament);
+		long long n = (long long)names.size();
+		numOfMatches = n * (n - 1) / 2;
+
+		if (!resumed)
+		{
+			scores.assign(names.size(), 0);
+			firstPairing = 0;
+		}
+
+		resumed = false;
+
+		if (checkpointPath.empty())
+		{
+			runPairings(firstPairing, numOfMatches);
+			return;
+		}
+
+		//Size segments to take about a quarter of the interval: the pause between segments stays
+		//negligible and a crash loses little more than one interval of work
+		long long minSegment = chunkSize * numOfThreads;
+		long long segment = minSegment;
+		double target = checkpointInterval / 4;
+		auto lastCheckpoint = chrono::steady_clock::now();
+
+		for (long long begin = firstPairing; begin < numOfMatches; )
+		{
+			auto start = chrono::steady_clock::now();
+			long long end = min(begin + segment, numOfMatches);
+			runPairings(begin, end);
+			begin = end;
+
+			auto now = chrono::steady_clock::now();
+			double took = chrono::duration<double>(now - start).count();
+
+			if (took < target / 2)
+			{
+				segment *= 2;
+			}
+			else if (took > target * 2)
+			{
+				segment = max(minSegment, segment / 2);
+			}
+
+			if (chrono::duration<double>(now - lastCheckpoint).count() >= checkpointInterval || begin == numOfMatches)
+			{
+				writeCheckpoint(begin);
+				lastCheckpoint = now;
+			}
+		}
+
+		//Nothing was left to play (an empty or already finished tournament): still leave a checkpoint
+		if (firstPairing >= numOfMatches)
+		{
+			writeCheckpoint(numOfMatches);
+		}
+	}
+
+	//Display the top entrants by total score
+	void displayRanking(ostream& out, int top)
+	{
+		vector<int> order(names.size());
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			order[i] = (int)i;
+		}
+
+		stable_sort(order.begin(), order.end(), [this](int x, int y) { return scores[x] > scores[y]; });
+
+		out << "entrants=" << names.size() << " matches=" << getNumOfMatches() << " rounds=" << numOfRounds << '\n';
+
+		for (int r = 0; r < (int)order.size() && r < top; r++)
+		{
+			int i = order[r];
+			out << "rank=" << r + 1 << " id=" << i + 1 << " name=" << names[i]
+				<< " strategy=" << getEntrantStrategy(i)
+				<< " score=" << scores[i] << '\n';
+		}
+	}
+};
+
+
+//Class caching the mean payoff per round of every pair of strategy types. Each pair plays its
+//matches only once, spread over a pool of threads; every cell has a single writer.
+class PairPayoffCache
+{
+private:
+	vector<double> payoff; //payoff[i * K + j]: mean payoff per round of type i against type j
+	int numOfTypes;
+	OutcomeCache* cache;   //Consulted before playing each match; nullptr for none
+
+	//Worker loop: claim pairs of types and write their payoffs
+	void worker(const vector<StrategySpec>& types, long long rounds, int samples, uint64_t seed, atomic<long long>& nextPair)
+	{
+		long long k = numOfTypes;
+		int orders = payoffs.isSymmetric() ? 1 : 2;
+
+		while (true)
+		{
+			long long pair = nextPair.fetch_add(1);
+			if (pair >= k * k)
+			{
+				break;
+			}
+
+			int i = (int)(pair / k), j = (int)(pair % k);
+			if (j < i)
+			{
+				continue; //Filled by the mirrored pair
+			}
+
+			double sumA = 0, sumB = 0;
+
+			//Under asymmetric payoffs every sample is also played with the roles swapped, and each
+			//type gets the mean over both roles
+			for (int order = 0; order < orders; order++)
+			{
+				bool swapped = (order == 1);
+
+				for (int sample = 0; sample < samples; sample++)
+				{
+					MatchConfig config;
+					setMatchStrategies(config, types[swapped ? j : i], types[swapped ? i : j]);
+					config.rounds = rounds;
+					config.seed = seed;
+					config.matchID = (uint64_t)((pair * samples + sample) * orders + order);
+					config.idA = (uint64_t)i;
+					config.idB = (uint64_t)j + (uint64_t)k; //Distinct streams when a type meets itself
+
+					if (swapped)
+					{
+						swap(config.idA, config.idB);
+					}
+
+					MatchResult result = cache ? cache->play(config) : playMatch(config);
+					sumA += (double)(swapped ? result.scoreB : result.scoreA);
+					sumB += (double)(swapped ? result.scoreA : result.scoreB);
+				}
+			}
+
+			double perRound = 1.0 / ((double)samples * (double)rounds * orders);
+			payoff[(size_t)(i * k + j)] = sumA * perRound;
+			payoff[(size_t)(j * k + i)] = sumB * perRound;
+
+			if (i == j)
+			{
+				payoff[(size_t)(i * k + i)] = 0.5 * (sumA + sumB) * perRound;
+			}
+		}
+	}
+
+public:
+	//Default Constructor
+	PairPayoffCache()
+	{
+		numOfTypes = 0;
+		cache = nullptr;
+	}
+
+	//Look matches up in a cache of outcomes before playing them, or stop with nullptr
+	void setOutcomeCache(OutcomeCache* outcomes)
+	{
+		cache = outcomes;
+	}
+
+	//Play every pair of types, averaging samples matches of the given length per pair
+	void compute(const vector<StrategySpec>& types, long long rounds, int samples, uint64_t seed, int numOfThreads)
+	{
+		IPD_TIME_SCOPE(PhasePayoffs);
+		numOfTypes = (int)types.size();
+		payoff.assign((size_t)numOfTypes * numOfTypes, 0.0);
+
+		atomic<long long> nextPair(0);
+		vector<thread> workers;
+
+		for (int t = 1; t < numOfThreads; t++)
+		{
+			workers.emplace_back(&PairPayoffCache::worker, this, cref(types), rounds, max(1, samples), seed, ref(nextPair));
+		}
+
+		worker(types, rounds, max(1, samples), seed, nextPair);
+
+		for (thread& w : workers)
+		{
+			w.join();
+		}
+	}
+
+	//Mean payoff per round of type i against type j
+	double get(int i, int j) const
+	{
+		return payoff[(size_t)i * numOfTypes + j];
+	}
+};
+
+
+//Class simulating evolutionary dynamics in a large well-mixed population of strategy types.
+//Agents are stored as one 16-bit type index each, and every pair of types plays its matches only
+//once (in parallel) to fill a PairPayoffCache; the dynamics then work from that cache alone.
+//Two update rules are supported:
+//  Moran: each step one agent, chosen in proportion to fitness, reproduces and its offspring
+//         replaces a uniformly chosen agent; a generation is populationSize steps.
+//  Replicator: each generation every type's share is scaled by its fitness over the mean fitness.
+//Fitness is 1 - selection + selection * (mean payoff per round against the rest of the population),
+//and with a mutation rate an offspring (or share) is redrawn uniformly over the types.
+class Population
+{
+private:
+	vector<StrategySpec> types;
+	PairPayoffCache payoff;
+	vector<uint16_t> agents;   //Strategy type of every agent
+	vector<long long> counts;  //Number of agents of each type
+	vector<double> meanPayoff; //Mean payoff per round of each type against the rest of the population
+	long long numOfRounds;
+	int samples;               //Matches averaged per pair of types
+	int numOfThreads;
+	uint64_t seed;
+	double selection;
+	double mutation;
+	RandomStream random;
+
+	int numOfTypes()
+	{
+		return (int)types.size();
+	}
+
+	//Payoff tables may hold negative entries, so fitness is kept from dropping below zero
+	double fitness(int type)
+	{
+		return max(0.0, 1.0 - selection + selection * meanPayoff[type]);
+	}
+
+	//Uniform integer in [0, n)
+	long long uniform(long long n)
+	{
+		return min(n - 1, (long long)(random.nextDouble() * (double)n));
+	}
+
+	//Mean payoff of every type against everyone else, from the current counts. An extinct type
+	//keeps the value it would have as one more agent, which moranStep's incremental update turns
+	//into its real mean payoff when a mutation brings it back.
+	void updateMeanPayoffs()
+	{
+		int k = numOfTypes();
+		double others = (double)max<long long>(1, (long long)agents.size() - 1);
+
+		for (int i = 0; i < k; i++)
+		{
+			double total = 0;
+
+			for (int j = 0; j < k; j++)
+			{
+				total += payoff.get(i, j) * (double)(counts[j] - (i == j ? 1 : 0));
+			}
+
+			meanPayoff[i] = total / others;
+		}
+	}
+
+	//One birth-death event; the mean payoffs are updated incrementally
+	void moranStep()
+	{
+		int k = numOfTypes();
+		double totalFitness = 0;
+
+		for (int i = 0; i < k; i++)
+		{
+			totalFitness += (double)counts[i] * fitness(i);
+		}
+
+		//Choose the parent type in proportion to fitness
+		double target = random.nextDouble() * totalFitness;
+		int parent = 0;
+
+		while (parent < k - 1 && (target -= (double)counts[parent] * fitness(parent)) >= 0)
+		{
+			parent++;
+		}
+
+		int child = parent;
+		if (mutation > 0 && random.nextDouble() < mutation)
+		{
+			child = (int)uniform(k);
+		}
+
+		long long victim = uniform((long long)agents.size());
+		int old = agents[(size_t)victim];
+
+		if (old == child)
+		{
+			return;
+		}
+
+		agents[(size_t)victim] = (uint16_t)child;
+		counts[old]--;
+		counts[child]++;
+
+		double others = (double)max<long long>(1, (long long)agents.size() - 1);
+
+		for (int i = 0; i < k; i++)
+		{
+			meanPayoff[i] += (payoff.get(i, child) - payoff.get(i, old)) / others;
+		}
+	}
+
+	//One discrete replicator generation; agents are rewritten as contiguous runs of each type
+	void replicatorGeneration()
+	{
+		int k = numOfTypes();
+		long long n = (long long)agents.size();
+		vector<double> share(k);
+		double meanFitness = 0;
+
+		for (int i = 0; i < k; i++)
+		{
+			share[i] = (double)counts[i] / (double)n;
+			meanFitness += share[i] * fitness(i);
+		}
+
+		if (meanFitness <= 0)
+		{
+			return;
+		}
+
+		//Round the new shares to whole agents by largest remainder
+		vector<pair<double, int>> remainders;
+		long long assigned = 0;
+
+		for (int i = 0; i < k; i++)
+		{
+			double next = share[i] * fitness(i) / meanFitness;
+			next = (1.0 - mutation) * next + mutation / k;
+
+			double exact = next * (double)n;
+			counts[i] = (long long)exact;
+			assigned += counts[i];
+			remainders.push_back(make_pair(exact - (double)counts[i], i));
+		}
+
+		sort(remainders.begin(), remainders.end(), [](const pair<double, int>& x, const pair<double, int>& y) {
+			return x.first > y.first || (x.first == y.first && x.second < y.second);
+		});
+
+		for (size_t r = 0; assigned < n; r = (r + 1) % remainders.size(), assigned++)
+		{
+			counts[remainders[r].second]++;
+		}
+
+		long long position = 0;
+		for (int i = 0; i < k; i++)
+		{
+			fill(agents.begin() + position, agents.begin() + position + counts[i], (uint16_t)i);
+			position += counts[i];
+		}
+
+		updateMeanPayoffs();
+	}
+
+public:
+	//Default Constructor
+	Population()
+	{
+		numOfRounds = 0;
+		samples = 1;
+		numOfThreads = 1;
+		seed = 0;
+		selection = 1.0;
+		mutation = 0.0;
+	}
+
+	void addType(const StrategySpec& spec)
+	{
+		types.push_back(spec);
+	}
+
+	void setNumberOfRounds(long long rounds)
+	{
+		numOfRounds = rounds;
+	}
+
+	void setSamples(int matchesPerPair)
+	{
+		samples = max(1, matchesPerPair);
+	}
+
+	void setNumberOfThreads(int threads)
+	{
+		numOfThreads = max(1, threads);
+	}
+
+	void setSeed(uint64_t newSeed)
+	{
+		seed = newSeed;
+	}
+
+	//Selection intensity, clamped to [0, 1]
+	void setSelection(double intensity)
+	{
+		selection = min(1.0, max(0.0, intensity));
+	}
+
+	//Mutation rate, clamped to [0, 1]
+	void setMutation(double rate)
+	{
+		mutation = min(1.0, max(0.0, rate));
+	}
+
+	//Look the matches of the payoff cache up in a cache of outcomes, or stop with nullptr
+	void setOutcomeCache(OutcomeCache* outcomes)
+	{
+		payoff.setOutcomeCache(outcomes);
+	}
+
+	//Fill the payoff cache, playing every pair of types across the threads
+	void computePayoffs()
+	{
+		payoff.compute(types, numOfRounds, samples, seed, numOfThreads);
+	}
+
+	//Start with populationSize agents split as evenly as possible between the types
+	void initialize(long long populationSize)
+	{
+		int k = numOfTypes();
+		agents.resize((size_t)populationSize);
+		counts.assign(k, 0);
+		meanPayoff.assign(k, 0.0);
+		random.seed(seed, ~0ULL, ~0ULL); //A stream no match uses
+
+		for (long long a = 0; a < populationSize; a++)
+		{
+			agents[(size_t)a] = (uint16_t)(a % k);
+			counts[a % k]++;
+		}
+
+		updateMeanPayoffs();
+	}
+
+	//Advance one generation of the chosen dynamics
+	void step(bool moran)
+	{
+		if (moran)
+		{
+			for (size_t s = 0; s < agents.size(); s++)
+			{
+				moranStep();
+			}
+
+			//Refresh the incrementally updated payoffs so rounding errors do not build up
+			updateMeanPayoffs();
+		}
+		else
+		{
+			replicatorGeneration();
+		}
+	}
+
+	//Display the number and share of agents of each type
+	void display(ostream& out, long long generation)
+	{
+		out << "generation=" << generation << '\n';
+
+		for (int i = 0; i < numOfTypes(); i++)
+		{
+			out << "type=" << types[i].name << " count=" << counts[i]
+				<< " share=" << (double)counts[i] / (double)agents.size()
+				<< " payoff=" << (counts[i] > 0 ? meanPayoff[i] : 0.0) << '\n';
+		}
+	}
+};
+
+
+//Class running the spatial game on an N x N torus. Each cell holds one 8-bit strategy type; every
+//generation each cell scores the cached pair payoffs against its 4 or 8 neighbours, then copies
+//the strategy of the best scoring cell among itself and its neighbours (ties keep the earliest in
+//scan order, self first). Generations are double-buffered and split into row bands, one per
+//thread. A band streams through its rows keeping only three rows of scores, so the working set
+//is a handful of rows regardless of N and no N x N score array is needed.
+class Lattice
+{
+private:
+	vector<StrategySpec> types;
+	PairPayoffCache payoff;
+	vector<float> payoffRows; //payoff.get(i, j) as floats, row-major, for the inner loop
+	vector<uint8_t> cells;    //Current generation
+	vector<uint8_t> nextCells;
+	long long size;
+	int neighbours;           //4 (von Neumann) or 8 (Moore)
+	int numOfThreads;
+	long long numOfRounds;
+	int samples;
+	uint64_t seed;
+
+	//Score every cell of row r against its neighbours
+	void scoreRow(long long r, float* scores)
+	{
+		int k = (int)types.size();
+		long long up = (r + size - 1) % size, down = (r + 1) % size;
+		const uint8_t* above = &cells[(size_t)(up * size)];
+		const uint8_t* row = &cells[(size_t)(r * size)];
+		const uint8_t* below = &cells[(size_t)(down * size)];
+
+		for (long long c = 0; c < size; c++)
+		{
+			long long left = (c == 0) ? size - 1 : c - 1, right = (c + 1 == size) ? 0 : c + 1;
+			const float* mine = &payoffRows[(size_t)row[c] * k];
+			float total = mine[above[c]] + mine[below[c]] + mine[row[left]] + mine[row[right]];
+
+			if (neighbours == 8)
+			{
+				total += mine[above[left]] + mine[above[right]] + mine[below[left]] + mine[below[right]];
+			}
+
+			scores[c] = total;
+		}
+	}
+
+	//Update rows [first, last) into nextCells, counting the new types into counts
+	void updateBand(long long first, long long last, vector<long long>& counts)
+	{
+		//Rolling buffer of the scores of rows r - 1, r and r + 1
+		vector<float> buffer((size_t)(3 * size));
+		float* previous = &buffer[0];
+		float* current = &buffer[(size_t)size];
+		float* next = &buffer[(size_t)(2 * size)];
+
+		scoreRow((first + size - 1) % size, previous);
+		scoreRow(first, current);
+
+		for (long long r = first; r < last; r++)
+		{
+			scoreRow((r + 1) % size, next);
+
+			const uint8_t* above = &cells[(size_t)(((r + size - 1) % size) * size)];
+			const uint8_t* row = &cells[(size_t)(r * size)];
+			const uint8_t* below = &cells[(size_t)(((r + 1) % size) * size)];
+			uint8_t* out = &nextCells[(size_t)(r * size)];
+
+			for (long long c = 0; c < size; c++)
+			{
+				long long left = (c == 0) ? size - 1 : c - 1, right = (c + 1 == size) ? 0 : c + 1;
+				float best = current[c];
+				uint8_t type = row[c];
+
+				//Candidates in a fixed order; strictly better scores win
+				if (previous[c] > best) { best = previous[c]; type = above[c]; }
+				if (next[c] > best) { best = next[c]; type = below[c]; }
+				if (current[left] > best) { best = current[left]; type = row[left]; }
+				if (current[right] > best) { best = current[right]; type = row[right]; }
+
+				if (neighbours == 8)
+				{
+					if (previous[left] > best) { best = previous[left]; type = above[left]; }
+					if (previous[right] > best) { best = previous[right]; type = above[right]; }
+					if (next[left] > best) { best = next[left]; type = below[left]; }
+					if (next[right] > best) { best = next[right]; type = below[right]; }
+				}
+
+				out[c] = type;
+				counts[type]++;
+			}
+
+			//Rotate the score rows
+			float* oldest = previous;
+			previous = current;
+			current = next;
+			next = oldest;
+		}
+	}
+
+public:
+	//Default Constructor
+	Lattice()
+	{
+		size = 0;
+		neighbours = 8;
+		numOfThreads = 1;
+		numOfRounds = 0;
+		samples = 1;
+		seed = 0;
+	}
+
+	void addType(const StrategySpec& spec)
+	{
+		types.push_back(spec);
+	}
+
+	void setNumberOfRounds(long long rounds)
+	{
+		numOfRounds = rounds;
+	}
+
+	void setSamples(int matchesPerPair)
+	{
+		samples = max(1, matchesPerPair);
+	}
+
+	void setNumberOfThreads(int threads)
+	{
+		numOfThreads = max(1, threads);
+	}
+
+	void setSeed(uint64_t newSeed)
+	{
+		seed = newSeed;
+	}
+
+	void setNeighbours(int count)
+	{
+		neighbours = (count == 4) ? 4 : 8;
+	}
+
+	//Look the matches of the payoff cache up in a cache of outcomes, or stop with nullptr
+	void setOutcomeCache(OutcomeCache* outcomes)
+	{
+		payoff.setOutcomeCache(outcomes);
+	}
+
+	long long getNumOfCells()
+	{
+		return size * size;
+	}
+
+	//Fill the payoff cache and scatter the types uniformly at random over an n x n grid
+	void initialize(long long n)
+	{
+		int k = (int)types.size();
+		size = n;
+
+		payoff.compute(types, numOfRounds, samples, seed, numOfThreads);
+		payoffRows.resize((size_t)k * k);
+
+		for (int i = 0; i < k; i++)
+		{
+			for (int j = 0; j < k; j++)
+			{
+				payoffRows[(size_t)i * k + j] = (float)payoff.get(i, j);
+			}
+		}
+
+		cells.resize((size_t)(size * size));
+		nextCells.resize(cells.size());
+
+		RandomStream random;
+		random.seed(seed, ~0ULL, ~0ULL - 1); //A stream no match uses
+
+		for (size_t c = 0; c < cells.size(); c++)
+		{
+			cells[c] = (uint8_t)(random.next32() % (uint32_t)k);
+		}
+	}
+
+	//Advance one generation and return the number of cells of each type afterwards
+	vector<long long> step()
+	{
+		int k = (int)types.size();
+		int bands = (int)min<long long>(numOfThreads, size);
+		vector<vector<long long>> bandCounts(bands, vector<long long>(k, 0));
+		vector<thread> workers;
+
+		for (int b = 1; b < bands; b++)
+		{
+			workers.emplace_back(&Lattice::updateBand, this, size * b / bands, size * (b + 1) / bands, ref(bandCounts[b]));
+		}
+
+		updateBand(0, size / bands, bandCounts[0]);
+
+		for (thread& worker : workers)
+		{
+			worker.join();
+		}
+
+		cells.swap(nextCells);
+
+		vector<long long> counts(k, 0);
+		for (int b = 0; b < bands; b++)
+		{
+			for (int i = 0; i < k; i++)
+			{
+				counts[i] += bandCounts[b][i];
+			}
+		}
+
+		return counts;
+	}
+
+	//Display the number and share of cells of each type
+	void display(ostream& out, long long generation, const vector<long long>& counts)
+	{
+		out << "generation=" << generation << '\n';
+
+		for (size_t i = 0; i < types.size(); i++)
+		{
+			out << "type=" << types[i].name << " count=" << counts[i]
+				<< " share=" << (double)counts[i] / (double)(size * size) << '\n';
+		}
+	}
+};
+
+
+//Timing and progress of one generation of the genetic search
+struct SearchStats
+{
+	long long generation = 0;
+	double bestFitness = 0;
+	double meanFitness = 0;
+	long long evaluated = 0;  //Distinct genomes scored this generation
+	long long cacheHits = 0;  //Genomes whose fitness was already known
+	long long matches = 0;
+	double evaluateSeconds = 0;
+	double breedSeconds = 0;
+};
+
+
+//Class evolving deterministic memory-n strategies with a genetic algorithm. A genome is the
+//move after each of the 4^n histories plus the history assumed before the first round, and its
+//fitness is the mean payoff per round against a fixed reference pool. Each generation the
+//genomes not yet seen are scored together: every (genome, reference) match is one job and the
+//workers claim jobs in chunks, so the threads stay busy however few new genomes there are.
+//Fitness is remembered by genome, so elites and rediscovered genomes cost nothing; once more than
+//maxCachedGenomes are remembered, only the current population's are kept. A genome's
+//matches are seeded from its own contents, making its fitness the same whenever it is scored.
+//Breeding uses tournament selection of size 3, one-point crossover and per-gene mutation, and
+//the best genome always survives unchanged.
+class GeneticSearch
+{
+private:
+	struct Genome
+	{
+		vector<uint8_t> defect; //Move after each history (1 = defect)
+		uint32_t start = 0;
+		double fitness = 0;
+	};
+
+	vector<StrategySpec> references;
+	vector<Genome> population;
+	unordered_map<string, double> fitnessCache;
+	vector<SearchStats> stats;
+	RandomStream random;
+	int memory;
+	long long numOfRounds;
+	int samples;
+	int numOfThreads;
+	double mutation;
+	double errorRate; //Probability that a move of an evolved strategy is flipped
+	uint64_t seed;
+
+	static constexpr long long chunkSize = 16;
+	static constexpr size_t maxCachedGenomes = 1 << 16;
+
+	uint32_t getNumOfGenes() const
+	{
+		return 1u << (2 * memory);
+	}
+
+	static string keyOf(const Genome& genome)
+	{
+		string key(genome.defect.begin(), genome.defect.end());
+		key.append((const char*)&genome.start, sizeof(genome.start));
+		return key;
+	}
+
+	//FNV-1a hash of a genome key, used as its match seed
+	static uint64_t hashOf(const string& key)
+	{
+		uint64_t hash = 14695981039346656037ULL;
+
+		for (unsigned char c : key)
+		{
+			hash = (hash ^ c) * 1099511628211ULL;
+		}
+
+		return hash;
+	}
+
+	StrategyTable toTable(const Genome& genome, const string& name) const
+	{
+		vector<double> cooperate(genome.defect.size());
+
+		for (size_t state = 0; state < cooperate.size(); state++)
+		{
+			cooperate[state] = genome.defect[state] ? 0.0 : 1.0;
+		}
+
+		return StrategyTable::fromMemory(name, memory, cooperate, genome.start);
+	}
+
+	//Worker loop: claim chunks of (genome, reference) jobs and store the payoff per round of each
+	void evaluateWorker(const vector<StrategyTable>& tables, const vector<uint64_t>& hashes, vector<double>& results, atomic<long long>& nextJob)
+	{
+		long long numOfJobs = (long long)results.size();
+		long long numOfRefs = (long long)references.size();
+		int orders = payoffs.isSymmetric() ? 1 : 2;
+
+		while (true)
+		{
+			long long first = nextJob.fetch_add(chunkSize);
+			if (first >= numOfJobs)
+			{
+				break;
+			}
+
+			long long last = min(first + chunkSize, numOfJobs);
+
+			for (long long job = first; job < last; job++)
+			{
+				size_t g = (size_t)(job / numOfRefs), r = (size_t)(job % numOfRefs);
+				double sum = 0;
+
+				//Under asymmetric payoffs the genome also plays every sample as the column player
+				for (int order = 0; order < orders; order++)
+				{
+					for (int sample = 0; sample < samples; sample++)
+					{
+						MatchConfig config;
+						setMatchStrategies(config, StrategySpec(), references[r]);
+						config.tableA = &tables[g];
+						config.noiseA = errorRate;
+						config.rounds = numOfRounds;
+						config.seed = seed ^ hashes[g];
+						config.matchID = (uint64_t)((r * samples + sample) * orders + order);
+						config.idA = 0;
+						config.idB = 1;
+
+						if (order == 1)
+						{
+							swap(config.strategyA, config.strategyB);
+							swap(config.firstMoveA, config.firstMoveB);
+							swap(config.tableA, config.tableB);
+							swap(config.noiseA, config.noiseB);
+							sum += (double)playMatch(config).scoreB;
+						}
+						else
+						{
+							sum += (double)playMatch(config).scoreA;
+						}
+					}
+				}
+
+				results[(size_t)job] = sum / ((double)samples * (double)numOfRounds * orders);
+			}
+		}
+	}
+
+	//Fill in the fitness of every genome, playing the matches of the unseen ones in one batch
+	void evaluate(SearchStats& stat)
+	{
+		vector<string> keys(population.size());
+		vector<size_t> pending; //Index of the first genome with each unseen key
+		unordered_map<string, size_t> pendingIndex;
+
+		for (size_t i = 0; i < population.size(); i++)
+		{
+			keys[i] = keyOf(population[i]);
+
+			if (fitnessCache.count(keys[i]))
+			{
+				stat.cacheHits++;
+				continue;
+			}
+
+			if (pendingIndex.emplace(keys[i], pending.size()).second)
+			{
+				pending.push_back(i);
+			}
+			else
+			{
+				stat.cacheHits++;
+			}
+		}
+
+		vector<StrategyTable> tables;
+		vector<uint64_t> hashes;
+
+		for (size_t i : pending)
+		{
+			tables.push_back(toTable(population[i], "Genome"));
+			hashes.push_back(hashOf(keys[i]));
+		}
+
+		vector<double> results(pending.size() * references.size());
+		atomic<long long> nextJob(0);
+		vector<thread> workers;
+
+		for (int t = 1; t < numOfThreads && (long long)t * chunkSize < (long long)results.size(); t++)
+		{
+			workers.emplace_back(&GeneticSearch::evaluateWorker, this, cref(tables), cref(hashes), ref(results), ref(nextJob));
+		}
+
+		evaluateWorker(tables, hashes, results, nextJob);
+
+		for (thread& worker : workers)
+		{
+			worker.join();
+		}
+
+		for (size_t p = 0; p < pending.size(); p++)
+		{
+			double sum = 0;
+
+			for (size_t r = 0; r < references.size(); r++)
+			{
+				sum += results[p * references.size() + r];
+			}
+
+			fitnessCache[keys[pending[p]]] = sum / (double)references.size();
+		}
+
+		for (size_t i = 0; i < population.size(); i++)
+		{
+			population[i].fitness = fitnessCache[keys[i]];
+		}
+
+		//Forget the genomes of earlier generations rather than let the cache grow without bound
+		if (fitnessCache.size() > maxCachedGenomes)
+		{
+			fitnessCache.clear();
+
+			for (size_t i = 0; i < population.size(); i++)
+			{
+				fitnessCache[keys[i]] = population[i].fitness;
+			}
+		}
+
+		stat.evaluated = (long long)pending.size();
+		stat.matches = (long long)results.size() * samples * (payoffs.isSymmetric() ? 1 : 2);
+	}
+
+	//Best of three genomes drawn uniformly
+	const Genome& select()
+	{
+		const Genome* best = &population[random.next32() % population.size()];
+
+		for (int k = 1; k < 3; k++)
+		{
+			const Genome& other = population[random.next32() % population.size()];
+			if (other.fitness > best->fitness)
+			{
+				best = &other;
+			}
+		}
+
+		return *best;
+	}
+
+	//Index of the fittest genome (the first one on ties)
+	size_t bestIndex() const
+	{
+		size_t best = 0;
+
+		for (size_t i = 1; i < population.size(); i++)
+		{
+			if (population[i].fitness > population[best].fitness)
+			{
+				best = i;
+			}
+		}
+
+		return best;
+	}
+
+	//Replace the population with the elite and the offspring of selected parents
+	void breed()
+	{
+		uint32_t genes = getNumOfGenes();
+		uint32_t historyMask = genes - 1;
+		vector<Genome> offspring;
+		offspring.reserve(population.size());
+		offspring.push_back(population[bestIndex()]);
+
+		while (offspring.size() < population.size())
+		{
+			const Genome& mother = select();
+			const Genome& father = select();
+			Genome child;
+			uint32_t cut = random.next32() % (genes + 1); //Genes before the cut come from the mother
+
+			child.defect.resize(genes);
+			for (uint32_t g = 0; g < genes; g++)
+			{
+				child.defect[g] = (g < cut ? mother : father).defect[g];
+
+				if (random.nextDouble() < mutation)
+				{
+					child.defect[g] ^= 1;
+				}
+			}
+
+			child.start = (random.nextBit() ? mother : father).start;
+			if (random.nextDouble() < mutation)
+			{
+				child.start = random.next32() & historyMask;
+			}
+
+			offspring.push_back(move(child));
+		}
+
+		population.swap(offspring);
+	}
+
+public:
+	//Default Constructor
+	GeneticSearch()
+	{
+		memory = 1;
+		numOfRounds = 0;
+		samples = 1;
+		numOfThreads = 1;
+		mutation = 0;
+		errorRate = 0;
+		seed = 0;
+	}
+
+	void addReference(const StrategySpec& spec)
+	{
+		references.push_back(spec);
+	}
+
+	void setMemory(int n)
+	{
+		memory = n;
+	}
+
+	void setNumberOfRounds(long long rounds)
+	{
+		numOfRounds = rounds;
+	}
+
+	void setSamples(int matchesPerReference)
+	{
+		samples = max(1, matchesPerReference);
+	}
+
+	void setNumberOfThreads(int threads)
+	{
+		numOfThreads = max(1, threads);
+	}
+
+	//Per-gene mutation probability; 0 picks one expected mutation per genome
+	void setMutation(double rate)
+	{
+		mutation = rate;
+	}
+
+	//Evaluate the evolved strategies under implementation noise
+	void setErrorRate(double rate)
+	{
+		errorRate = rate;
+	}
+
+	void setSeed(uint64_t newSeed)
+	{
+		seed = newSeed;
+	}
+
+	const vector<SearchStats>& getStats() const
+	{
+		return stats;
+	}
+
+	//Draw size random genomes and score them
+	void initialize(long long size)
+	{
+		uint32_t genes = getNumOfGenes();
+
+		if (mutation <= 0)
+		{
+			mutation = 1.0 / (double)(genes + 1);
+		}
+
+		random.seed(seed, ~0ULL - 2, 0); //A stream no match uses
+		population.assign((size_t)size, Genome());
+
+		for (Genome& genome : population)
+		{
+			genome.defect.resize(genes);
+
+			for (uint32_t g = 0; g < genes; g++)
+			{
+				genome.defect[g] = (uint8_t)random.nextBit();
+			}
+
+			genome.start = random.next32() & (genes - 1);
+		}
+
+		SearchStats stat;
+		auto start = chrono::steady_clock::now();
+		evaluate(stat);
+		stat.evaluateSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		record(stat);
+	}
+
+	//Breed the next generation and score it
+	void step()
+	{
+		SearchStats stat;
+		stat.generation = (long long)stats.size();
+
+		auto start = chrono::steady_clock::now();
+		breed();
+		auto bred = chrono::steady_clock::now();
+		evaluate(stat);
+		auto end = chrono::steady_clock::now();
+
+		stat.breedSeconds = chrono::duration<double>(bred - start).count();
+		stat.evaluateSeconds = chrono::duration<double>(end - bred).count();
+		record(stat);
+	}
+
+	//Fill in the fitness summary of a generation and keep its stats
+	void record(SearchStats& stat)
+	{
+		double sum = 0;
+
+		for (const Genome& genome : population)
+		{
+			sum += genome.fitness;
+		}
+
+		stat.bestFitness = population[bestIndex()].fitness;
+		stat.meanFitness = sum / (double)population.size();
+		stats.push_back(stat);
+	}
+
+	//Display the stats of the latest generation
+	void displayStats(ostream& out) const
+	{
+		const SearchStats& stat = stats.back();
+		double seconds = stat.evaluateSeconds + stat.breedSeconds;
+
+		out << "generation=" << stat.generation << " best=" << stat.bestFitness << " mean=" << stat.meanFitness
+			<< " evaluated=" << stat.evaluated << " cache_hits=" << stat.cacheHits << " matches=" << stat.matches
+			<< " evaluate_ms=" << stat.evaluateSeconds * 1000.0 << " breed_ms=" << stat.breedSeconds * 1000.0
+			<< " matches_per_s=" << (seconds > 0 ? (double)stat.matches / seconds : 0) << '\n';
+	}
+
+	//Display the fittest genome as a line of a strategy file, loadable with --strategies
+	void displayBest(ostream& out) const
+	{
+		const Genome& best = population[bestIndex()];
+
+		out << "Evolved memory " << memory;
+		for (uint8_t d : best.defect)
+		{
+			out << ' ' << (d ? 0 : 1);
+		}
+		out << " start " << best.start << '\n';
+	}
+
+	long long getNumOfCachedGenomes() const
+	{
+		return (long long)fitnessCache.size();
+	}
+};
+
+//Transpose a 64x64 bit matrix in place: afterwards bit l of word i is what bit i of word l was
+void transpose64(uint64_t a[64]);
+
+
+//Scores of every match in a bit-sliced batch
+struct BatchResult
+{
+	vector<MatchResult> matches; //Match m of the batch is matches[m]
+	long long totalA = 0;        //Summed over all matches with popcounts of the bit-plane counters
+	long long totalB = 0;
+};
+
+
+//Class simulating many independent matches of one pairing at once, one match per bit lane.
+//Each word holds one move of 64 matches (1 = defect), so a round of 64 matches is a handful of
+//bitwise operations: tit for tat copies the opponent's word, Cooperate and Evil are constants
+//and Random is a word of random bits. The outcomes of each round are added to per-lane
+//counters stored as bit planes (vertical counters), from which per-match scores are read out.
+//Match m uses matchID firstMatchID + m and exactly the same random streams as playMatch(), so
+//every lane can be checked against the scalar engine.
+class BitSlicedBatch
+{
+private:
+	//Words processed together per pass; the per-word loops are simple enough to vectorise
+	static constexpr int wordsPerPass = 4;
+	static constexpr int lanesPerPass = 64 * wordsPerPass;
+
+	//Per-lane counters of the three joint moves that are not mutual defection
+	enum Outcome { BothCooperate, OnlyBDefects, OnlyADefects, NumOfOutcomes };
+
+	MatchConfig pairing;
+	uint64_t counters[NumOfOutcomes][64][wordsPerPass];
+	int numOfPlanes;
+
+	//Add 1 to the counters of the lanes set in mask (ripple carry through the bit planes)
+	void increment(int outcome, int word, uint64_t mask)
+	{
+		for (int plane = 0; mask != 0; plane++)
+		{
+			uint64_t carry = counters[outcome][plane][word] & mask;
+			counters[outcome][plane][word] ^= mask;
+			mask = carry;
+		}
+	}
+
+	//Counter value of one lane
+	long long laneCount(int outcome, int lane)
+	{
+		long long count = 0;
+
+		for (int plane = 0; plane < numOfPlanes; plane++)
+		{
+			count |= (long long)((counters[outcome][plane][lane >> 6] >> (lane & 63)) & 1) << plane;
+		}
+
+		return count;
+	}
+
+	//Counter total over the first numOfLanes lanes, using popcounts of the bit planes
+	long long totalCount(int outcome, int numOfLanes)
+	{
+		long long total = 0;
+
+		for (int plane = 0; plane < numOfPlanes; plane++)
+		{
+			for (int word = 0; word * 64 < numOfLanes; word++)
+			{
+				int lanes = min(64, numOfLanes - word * 64);
+				uint64_t valid = (lanes == 64) ? ~0ULL : ((1ULL << lanes) - 1);
+				total += (long long)countBits(counters[outcome][plane][word] & valid) << plane;
+			}
+		}
+
+		return total;
+	}
+
+	//Fill moves[round][word] with the next 64 rounds of random bits of each lane's stream
+	static void drawRandomBlock(RandomStream* streams, uint64_t moves[][wordsPerPass], int words)
+	{
+		uint64_t block[64];
+
+		for (int word = 0; word < words; word++)
+		{
+			for (int lane = 0; lane < 64; lane++)
+			{
+				block[lane] = streams[word * 64 + lane].nextWord();
+			}
+
+			transpose64(block);
+
+			for (int round = 0; round < 64; round++)
+			{
+				moves[round][word] = block[round];
+			}
+		}
+	}
+
+	//Fill flips[round][word] with the noise of the next 64 rounds of each lane. Between errors a
+	//lane costs one comparison per block, and a block with no flips in any lane skips the transpose.
+	static void drawNoiseBlock(NoiseStream* streams, uint64_t flips[][wordsPerPass], int words)
+	{
+		uint64_t block[64];
+
+		for (int word = 0; word < words; word++)
+		{
+			uint64_t any = 0;
+
+			for (int lane = 0; lane < 64; lane++)
+			{
+				block[lane] = streams[word * 64 + lane].nextBlock();
+				any |= block[lane];
+			}
+
+			if (any != 0)
+			{
+				transpose64(block);
+			}
+
+			for (int round = 0; round < 64; round++)
+			{
+				flips[round][word] = block[round];
+			}
+		}
+	}
+
+	//Move words of one side for a round, given the opponent's last move words
+	static void decide(char strategy, const uint64_t opponentLast[], const uint64_t randomBits[], uint64_t move[], int words)
+	{
+		for (int word = 0; word < words; word++)
+		{
+			switch (strategy)
+			{
+				case 'c':
+					move[word] = 0;
+					break;
+
+				case 'e':
+					move[word] = ~0ULL;
+					break;
+
+				case 't':
+					move[word] = opponentLast[word];
+					break;
+
+				default: //Random
+					move[word] = randomBits[word];
+					break;
+			}
+		}
+	}
+
+	//Play one pass of up to lanesPerPass matches starting at match firstMatch of the batch
+	void runPass(long long firstMatch, int numOfLanes, BatchResult& result)
+	{
+		int words = (numOfLanes + 63) / 64;
+		bool randomA = (pairing.strategyA == 'r');
+		bool randomB = (pairing.strategyB == 'r');
+
+		bool noisyA = (pairing.noiseA > 0);
+		bool noisyB = (pairing.noiseB > 0);
+
+		static thread_local RandomStream streamsA[lanesPerPass], streamsB[lanesPerPass];
+		static thread_local uint64_t randomA64[64][wordsPerPass], randomB64[64][wordsPerPass];
+		static thread_local NoiseStream noiseA[lanesPerPass], noiseB[lanesPerPass];
+		static thread_local uint64_t flipsA64[64][wordsPerPass], flipsB64[64][wordsPerPass];
+
+		for (int lane = 0; lane < words * 64; lane++)
+		{
+			streamsA[lane].seed(pairing.seed, pairing.matchID + firstMatch + lane, pairing.idA);
+			streamsB[lane].seed(pairing.seed, pairing.matchID + firstMatch + lane, pairing.idB);
+
+			if (noisyA)
+			{
+				noiseA[lane].seed(pairing.noiseA, pairing.seed, pairing.matchID + firstMatch + lane, pairing.idA);
+			}
+
+			if (noisyB)
+			{
+				noiseB[lane].seed(pairing.noiseB, pairing.seed, pairing.matchID + firstMatch + lane, pairing.idB);
+			}
+		}
+
+		for (int outcome = 0; outcome < NumOfOutcomes; outcome++)
+		{
+			for (int plane = 0; plane < numOfPlanes; plane++)
+			{
+				for (int word = 0; word < wordsPerPass; word++)
+				{
+					counters[outcome][plane][word] = 0;
+				}
+			}
+		}
+
+		//Before the first round tit for tat "copies" its own first move, as in Game::simulate
+		uint64_t opponentOfA[wordsPerPass], opponentOfB[wordsPerPass];
+		uint64_t moveA[wordsPerPass], moveB[wordsPerPass];
+
+		for (int word = 0; word < wordsPerPass; word++)
+		{
+			opponentOfA[word] = (pairing.strategyA == 't' && pairing.firstMoveA == 'd') ? ~0ULL : 0;
+			opponentOfB[word] = (pairing.strategyB == 't' && pairing.firstMoveB == 'd') ? ~0ULL : 0;
+		}
+
+		for (long long round = 0; round < pairing.rounds; round++)
+		{
+			int inBlock = (int)(round & 63);
+
+			if (inBlock == 0)
+			{
+				if (randomA)
+				{
+					drawRandomBlock(streamsA, randomA64, words);
+				}
+
+				if (randomB)
+				{
+					drawRandomBlock(streamsB, randomB64, words);
+				}
+
+				if (noisyA)
+				{
+					drawNoiseBlock(noiseA, flipsA64, words);
+				}
+
+				if (noisyB)
+				{
+					drawNoiseBlock(noiseB, flipsB64, words);
+				}
+			}
+
+			decide(pairing.strategyA, opponentOfA, randomA64[inBlock], moveA, words);
+			decide(pairing.strategyB, opponentOfB, randomB64[inBlock], moveB, words);
+
+			if (noisyA || noisyB)
+			{
+				for (int word = 0; word < words; word++)
+				{
+					moveA[word] ^= noisyA ? flipsA64[inBlock][word] : 0;
+					moveB[word] ^= noisyB ? flipsB64[inBlock][word] : 0;
+				}
+			}
+
+			for (int word = 0; word < words; word++)
+			{
+				increment(BothCooperate, word, ~moveA[word] & ~moveB[word]);
+				increment(OnlyBDefects, word, ~moveA[word] & moveB[word]);
+				increment(OnlyADefects, word, moveA[word] & ~moveB[word]);
+
+				opponentOfA[word] = moveB[word];
+				opponentOfB[word] = moveA[word];
+			}
+		}
+
+		//Mutual defection is whatever is left of the rounds
+		for (int lane = 0; lane < numOfLanes; lane++)
+		{
+			long long cc = laneCount(BothCooperate, lane);
+			long long cd = laneCount(OnlyBDefects, lane);
+			long long dc = laneCount(OnlyADefects, lane);
+			long long dd = pairing.rounds - cc - cd - dc;
+
+			MatchResult match;
+			match.scoreA = payoffs.total(0, cc, cd, dc, dd);
+			match.scoreB = payoffs.total(1, cc, cd, dc, dd);
+			result.matches[(size_t)(firstMatch + lane)] = match;
+		}
+
+		long long cc = totalCount(BothCooperate, numOfLanes);
+		long long cd = totalCount(OnlyBDefects, numOfLanes);
+		long long dc = totalCount(OnlyADefects, numOfLanes);
+		long long dd = pairing.rounds * numOfLanes - cc - cd - dc;
+
+		result.totalA += payoffs.total(0, cc, cd, dc, dd);
+		result.totalB += payoffs.total(1, cc, cd, dc, dd);
+	}
+
+public:
+	//Play numOfMatches matches of the pairing; match m uses matchID pairing.matchID + m.
+	//Only the built-in strategies r, c, e and t are supported.
+	BatchResult run(const MatchConfig& config, long long numOfMatches)
+	{
+		BatchResult result;
+		result.matches.resize((size_t)numOfMatches);
+		pairing = config;
+
+		//Enough bit planes to count up to the number of rounds
+		numOfPlanes = 1;
+		while (numOfPlanes < 63 && (1LL << numOfPlanes) <= pairing.rounds)
+		{
+			numOfPlanes++;
+		}
+
+		for (long long first = 0; first < numOfMatches; first += lanesPerPass)
+		{
+			runPass(first, (int)min<long long>(lanesPerPass, numOfMatches - first), result);
+		}
+
+		return result;
+	}
+};
+
+//Expected scores of the two sides of a match, in total or per round
+struct ExpectedScores
+{
+	double scoreA = 0;
+	double scoreB = 0;
+};
+
+//Class computing the expected scores of a match exactly instead of simulating it. Every strategy
+//is a table (the built-ins through StrategyLibrary::builtin) whose move depends only on its state,
+//so a match is a Markov chain over the joint states (stateA, stateB); for memory-one strategies
+//that is at most 5 x 5 states. Noise only changes the cooperation probability of each state.
+//Expected totals over R rounds take O(n^3 log R) through repeated squaring.
+class MarkovMatch
+{
+private:
+	int numOfStates;
+	int start;
+	vector<double> transition; //transition[s * n + t]: probability of going from joint state s to t
+	vector<double> rewardA;    //Expected payoff of each side for a round played in each state
+	vector<double> rewardB;
+
+	//Largest joint chain built; bigger pairings are left to the simulator
+	static constexpr int maxStates = 256;
+
+	//c = a * b for n x n matrices
+	void multiply(const vector<double>& a, const vector<double>& b, vector<double>& c) const
+	{
+		int n = numOfStates;
+		c.assign((size_t)n * n, 0.0);
+
+		for (int i = 0; i < n; i++)
+		{
+			for (int k = 0; k < n; k++)
+			{
+				double aik = a[(size_t)i * n + k];
+
+				if (aik == 0)
+				{
+					continue;
+				}
+
+				for (int j = 0; j < n; j++)
+				{
+					c[(size_t)i * n + j] += aik * b[(size_t)k * n + j];
+				}
+			}
+		}
+	}
+
+	//Scale every row of an n x n matrix to the given sum. Powers of a stochastic matrix have rows
+	//summing to 1, and the sums of k powers rows summing to k; restoring that after each product
+	//stops rounding errors from doubling with every squaring.
+	void normalizeRows(vector<double>& m, double rowSum) const
+	{
+		int n = numOfStates;
+
+		for (int i = 0; i < n; i++)
+		{
+			double total = 0;
+			for (int j = 0; j < n; j++)
+			{
+				total += m[(size_t)i * n + j];
+			}
+
+			if (total > 0)
+			{
+				for (int j = 0; j < n; j++)
+				{
+					m[(size_t)i * n + j] *= rowSum / total;
+				}
+			}
+		}
+	}
+
+	//Expected number of rounds spent in each joint state over the first R rounds: the start row of
+	//I + M + .. + M^(R-1). Blocks (M^k, I + .. + M^(k-1)) are combined by binary expansion of R.
+	vector<double> occupancy(long long rounds) const
+	{
+		int n = numOfStates;
+		vector<double> identity((size_t)n * n, 0.0);
+
+		for (int i = 0; i < n; i++)
+		{
+			identity[(size_t)i * n + i] = 1.0;
+		}
+
+		vector<double> power = transition, sum = identity; //Block of 1 round
+		vector<double> accPower = identity, accSum((size_t)n * n, 0.0); //Block of 0 rounds
+		double length = 1, accLength = 0;
+		vector<double> product, temp;
+
+		for (long long bits = rounds; bits > 0; bits >>= 1)
+		{
+			if (bits & 1)
+			{
+				//Appending a block: sum' = accSum + accPower * sum, power' = accPower * power
+				multiply(accPower, sum, product);
+				for (size_t i = 0; i < product.size(); i++)
+				{
+					accSum[i] += product[i];
+				}
+
+				multiply(accPower, power, temp);
+				accPower.swap(temp);
+				accLength += length;
+				normalizeRows(accSum, accLength);
+				normalizeRows(accPower, 1.0);
+			}
+
+			if (bits > 1)
+			{
+				//Doubling a block: sum' = sum + power * sum, power' = power * power
+				multiply(power, sum, product);
+				for (size_t i = 0; i < product.size(); i++)
+				{
+					sum[i] += product[i];
+				}
+
+				multiply(power, power, temp);
+				power.swap(temp);
+				length *= 2;
+				normalizeRows(sum, length);
+				normalizeRows(power, 1.0);
+			}
+		}
+
+		return vector<double>(accSum.begin() + (size_t)start * n, accSum.begin() + (size_t)(start + 1) * n);
+	}
+
+public:
+	//Default Constructor
+	MarkovMatch()
+	{
+		numOfStates = 0;
+		start = 0;
+	}
+
+	//Build the chain of a match under the active payoffs; false with a message if a strategy is
+	//unknown or the joint chain would exceed maxStates
+	bool build(const MatchConfig& config, string& error)
+	{
+		const StrategyTable* a = config.tableA ? config.tableA : StrategyLibrary::builtin(config.strategyA, config.firstMoveA);
+		const StrategyTable* b = config.tableB ? config.tableB : StrategyLibrary::builtin(config.strategyB, config.firstMoveB);
+
+		if (a == nullptr || b == nullptr)
+		{
+			error = "unknown strategy";
+			return false;
+		}
+
+		int statesA = (int)a->getNumOfStates(), statesB = (int)b->getNumOfStates();
+
+		if ((long long)statesA * statesB > maxStates)
+		{
+			error = "the joint chain of " + a->getName() + " and " + b->getName() + " has more than "
+				+ to_string(maxStates) + " states";
+			return false;
+		}
+
+		int n = numOfStates = statesA * statesB;
+		start = (int)(a->getInitialState() * statesB + b->getInitialState());
+		transition.assign((size_t)n * n, 0.0);
+		rewardA.assign(n, 0.0);
+		rewardB.assign(n, 0.0);
+
+		for (int sa = 0; sa < statesA; sa++)
+		{
+			for (int sb = 0; sb < statesB; sb++)
+			{
+				int s = sa * statesB + sb;
+
+				//Noise flips the chosen move with the side's error rate
+				double coopA = a->getCooperation(sa), coopB = b->getCooperation(sb);
+				coopA = coopA * (1 - config.noiseA) + (1 - coopA) * config.noiseA;
+				coopB = coopB * (1 - config.noiseB) + (1 - coopB) * config.noiseB;
+
+				for (int moveA = 0; moveA < 2; moveA++)
+				{
+					for (int moveB = 0; moveB < 2; moveB++)
+					{
+						double p = (moveA ? 1 - coopA : coopA) * (moveB ? 1 - coopB : coopB);
+
+						if (p == 0)
+						{
+							continue;
+						}
+
+						int t = (int)(a->nextState(sa, (moveA << 1) | moveB) * statesB + b->nextState(sb, (moveB << 1) | moveA));
+						transition[(size_t)s * n + t] += p;
+						rewardA[s] += p * payoffs.get(0, moveA, moveB);
+						rewardB[s] += p * payoffs.get(1, moveB, moveA);
+					}
+				}
+			}
+		}
+
+		return true;
+	}
+
+	int getNumOfStates() const
+	{
+		return numOfStates;
+	}
+
+	//Expected total scores over the given number of rounds
+	ExpectedScores expected(long long rounds) const
+	{
+		ExpectedScores result;
+
+		if (rounds <= 0)
+		{
+			return result;
+		}
+
+		vector<double> visits = occupancy(rounds);
+
+		for (int s = 0; s < numOfStates; s++)
+		{
+			result.scoreA += visits[s] * rewardA[s];
+			result.scoreB += visits[s] * rewardB[s];
+		}
+
+		return result;
+	}
+
+	//Mean score per round when the match continues after each round with probability delta
+	//(equivalently, payoffs discounted by delta): (1 - delta) * start row of (I - delta M)^-1 r
+	ExpectedScores discounted(double delta) const
+	{
+		//Solve x (I - delta M) = e_start, i.e. (I - delta M)^T x = e_start, by Gaussian elimination
+		int n = numOfStates;
+		vector<double> system((size_t)n * (n + 1), 0.0);
+
+		for (int i = 0; i < n; i++)
+		{
+			for (int j = 0; j < n; j++)
+			{
+				system[(size_t)i * (n + 1) + j] = (i == j ? 1.0 : 0.0) - delta * transition[(size_t)j * n + i];
+			}
+
+			system[(size_t)i * (n + 1) + n] = (i == start) ? 1.0 : 0.0;
+		}
+
+		for (int col = 0; col < n; col++)
+		{
+			int pivot = col;
+			for (int row = col + 1; row < n; row++)
+			{
+				if (fabs(system[(size_t)row * (n + 1) + col]) > fabs(system[(size_t)pivot * (n + 1) + col]))
+				{
+					pivot = row;
+				}
+			}
+
+			for (int j = 0; j <= n; j++)
+			{
+				swap(system[(size_t)col * (n + 1) + j], system[(size_t)pivot * (n + 1) + j]);
+			}
+
+			for (int row = 0; row < n; row++)
+			{
+				double factor = system[(size_t)row * (n + 1) + col] / system[(size_t)col * (n + 1) + col];
+
+				if (row == col || factor == 0)
+				{
+					continue;
+				}
+
+				for (int j = col; j <= n; j++)
+				{
+					system[(size_t)row * (n + 1) + j] -= factor * system[(size_t)col * (n + 1) + j];
+				}
+			}
+		}
+
+		ExpectedScores result;
+
+		for (int s = 0; s < n; s++)
+		{
+			double visits = system[(size_t)s * (n + 1) + n] / system[(size_t)s * (n + 1) + s];
+			result.scoreA += (1 - delta) * visits * rewardA[s];
+			result.scoreB += (1 - delta) * visits * rewardB[s];
+		}
+
+		return result;
+	}
+
+	//Long-run mean score per round. This is the stationary payoff when the chain is ergodic (as
+	//any noise makes it) and the Cesaro limit otherwise, taken over 2^40 rounds.
+	ExpectedScores longRun() const
+	{
+		const double rounds = 1099511627776.0;
+		ExpectedScores total = expected(1LL << 40);
+
+		total.scoreA /= rounds;
+		total.scoreB /= rounds;
+		return total;
+	}
+};
+
+
+//Running mean and variance of a stream of samples (Welford's update, which stays accurate when
+//the variance is small next to the mean)
+struct RunningStats
+{
+	long long count = 0;
+	double mean = 0;
+	double m2 = 0; //Sum of squared deviations from the mean
+
+	void add(double sample)
+	{
+		count++;
+		double delta = sample - mean;
+		mean += delta / (double)count;
+		m2 += delta * (sample - mean);
+	}
+
+	double variance() const
+	{
+		return (count > 1) ? m2 / (double)(count - 1) : 0.0;
+	}
+
+	//Half-width of the normal-approximation confidence interval of the mean, z standard errors wide
+	double halfWidth(double z) const
+	{
+		return (count > 1) ? z * sqrt(variance() / (double)count) : HUGE_VAL;
+	}
+};
+
+
+//Class repeating a pairing or a whole tournament with independent random streams until the
+//confidence interval of every player's mean score is narrower than a target width. Replicates
+//are played in batches across a pool of threads, then streamed into the accumulators in
+//replicate order, so the statistics and the stopping point do not depend on the thread count.
+class ReplicateRunner
+{
+private:
+	MatchConfig pairing;
+	Tournament tournament;
+	bool isTournament;
+	vector<string> names;
+	vector<string> strategies;
+	vector<RunningStats> stats;
+	long long minReplicates;
+	long long maxReplicates;
+	long long numOfReplicates;
+	double targetWidth;
+	double z;
+	int numOfThreads;
+	uint64_t seed;
+	bool converged;
+
+	//Seed of a tournament replicate; replicate r of a pairing is its match r instead
+	uint64_t replicateSeed(long long r) const
+	{
+		RandomStream stream;
+		stream.seed(seed, (uint64_t)r, 0);
+		return stream.nextWord();
+	}
+
+	//Worker loop: claim replicates of the batch starting at first and store their scores
+	void worker(long long first, long long count, vector<long long>& scores, atomic<long long>& next)
+	{
+		size_t sides = names.size();
+		Tournament replicate;
+
+		if (isTournament)
+		{
+			replicate = tournament;
+			replicate.setNumberOfThreads(1);
+		}
+
+		for (long long j = next.fetch_add(1); j < count; j = next.fetch_add(1))
+		{
+			long long* out = &scores[(size_t)j * sides];
+
+			if (isTournament)
+			{
+				replicate.setSeed(replicateSeed(first + j));
+				replicate.run();
+
+				for (size_t i = 0; i < sides; i++)
+				{
+					out[i] = replicate.getScore((int)i);
+				}
+			}
+			else
+			{
+				MatchConfig config = pairing;
+				config.matchID = (uint64_t)(first + j);
+
+				MatchResult result = playMatch(config);
+				out[0] = result.scoreA;
+				out[1] = result.scoreB;
+			}
+		}
+	}
+
+	//Widest confidence interval over the players, relative to the target width
+	double widestRatio() const
+	{
+		double ratio = 0;
+
+		for (const RunningStats& s : stats)
+		{
+			ratio = max(ratio, 2.0 * s.halfWidth(z) / targetWidth);
+		}
+
+		return ratio;
+	}
+
+	//Replicates to play next: enough to reach the target if the spread stays as it is, at least
+	//a few per thread, and never more than have been played so far (so the overshoot stays bounded)
+	long long nextBatchSize() const
+	{
+		long long smallest = 4LL * numOfThreads;
+
+		if (numOfReplicates < minReplicates)
+		{
+			return max(smallest, minReplicates - numOfReplicates);
+		}
+
+		double ratio = widestRatio();
+		double predicted = (double)numOfReplicates * ratio * ratio;
+		long long wanted = (long long)min(predicted - (double)numOfReplicates, 1e15) + 1;
+
+		return max(smallest, min(wanted, numOfReplicates));
+	}
+
+public:
+	//Default Constructor
+	ReplicateRunner()
+	{
+		isTournament = false;
+		minReplicates = 10;
+		maxReplicates = 100000;
+		numOfReplicates = 0;
+		targetWidth = 1;
+		z = 1.959963984540054; //95% confidence
+		numOfThreads = 1;
+		seed = 0;
+		converged = false;
+	}
+
+	//Repeat a single match; the match ID of the config is replaced by the replicate number
+	void setPairing(const MatchConfig& config, const string& nameA, const string& nameB)
+	{
+		pairing = config;
+		isTournament = false;
+		names = { nameA, nameB };
+		strategies = { config.tableA ? config.tableA->getName() : string(1, config.strategyA),
+			config.tableB ? config.tableB->getName() : string(1, config.strategyB) };
+	}
+
+	//Repeat a whole tournament; each replicate runs on one thread with a seed of its own
+	void setTournament(const Tournament& prototype)
+	{
+		tournament = prototype;
+		isTournament = true;
+		names.clear();
+		strategies.clear();
+
+		for (int i = 0; i < tournament.getNumOfEntrants(); i++)
+		{
+			names.push_back(tournament.getEntrantName(i));
+			strategies.push_back(tournament.getEntrantStrategy(i));
+		}
+	}
+
+	//Stop once every player's confidence interval is narrower than width (in score units)
+	void setTargetWidth(double width)
+	{
+		targetWidth = width;
+	}
+
+	//Confidence level of the intervals, such as 0.95
+	void setConfidence(double level)
+	{
+		//Inverse of the normal CDF by bisection; the level is clamped to a sensible range
+		double p = 0.5 + 0.5 * min(max(level, 0.5), 0.999999);
+		double low = 0, high = 10;
+
+		for (int i = 0; i < 100; i++)
+		{
+			double mid = 0.5 * (low + high);
+
+			if (0.5 * erfc(-mid / sqrt(2.0)) < p)
+			{
+				low = mid;
+			}
+			else
+			{
+				high = mid;
+			}
+		}
+
+		z = 0.5 * (low + high);
+	}
+
+	//Replicates played before the first check, and the most that are played
+	void setReplicateLimits(long long minimum, long long maximum)
+	{
+		minReplicates = max(2LL, minimum);
+		maxReplicates = max(minReplicates, maximum);
+	}
+
+	void setNumberOfThreads(int threads)
+	{
+		numOfThreads = max(1, threads);
+	}
+
+	void setSeed(uint64_t newSeed)
+	{
+		seed = newSeed;
+		pairing.seed = newSeed;
+	}
+
+	//Play batches of replicates until the intervals are narrow enough or the maximum is reached
+	void run()
+	{
+		size_t sides = names.size();
+		stats.assign(sides, RunningStats());
+		numOfReplicates = 0;
+		converged = false;
+
+		vector<long long> scores;
+
+		while (!converged && numOfReplicates < maxReplicates)
+		{
+			long long first = numOfReplicates;
+			long long count = min(nextBatchSize(), maxReplicates - first);
+			scores.assign((size_t)count * sides, 0);
+
+			atomic<long long> next(0);
+			vector<thread> workers;
+			int threads = (int)min<long long>(numOfThreads, count);
+
+			for (int t = 1; t < threads; t++)
+			{
+				workers.emplace_back(&ReplicateRunner::worker, this, first, count, ref(scores), ref(next));
+			}
+
+			worker(first, count, scores, next);
+
+			for (thread& t : workers)
+			{
+				t.join();
+			}
+
+			//Replicates beyond the one that met the target are discarded
+			for (long long j = 0; j < count && !converged; j++)
+			{
+				for (size_t i = 0; i < sides; i++)
+				{
+					stats[i].add((double)scores[(size_t)j * sides + i]);
+				}
+
+				numOfReplicates++;
+				converged = (numOfReplicates >= minReplicates && widestRatio() <= 1.0);
+			}
+		}
+	}
+
+	long long getNumOfReplicates() const
+	{
+		return numOfReplicates;
+	}
+
+	bool isConverged() const
+	{
+		return converged;
+	}
+
+	const RunningStats& getStats(int player) const
+	{
+		return stats[player];
+	}
+
+	//Display the mean score and confidence interval of the top players, best mean first
+	void displayResult(ostream& out, int top)
+	{
+		vector<int> order(names.size());
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			order[i] = (int)i;
+		}
+
+		stable_sort(order.begin(), order.end(), [this](int x, int y) { return stats[x].mean > stats[y].mean; });
+
+		out << "replicates=" << numOfReplicates << " converged=" << (converged ? "yes" : "no")
+			<< " target_width=" << targetWidth << " z=" << z << '\n';
+
+		for (int r = 0; r < (int)order.size() && r < top; r++)
+		{
+			int i = order[r];
+			double half = stats[i].halfWidth(z);
+
+			out << "rank=" << r + 1 << " id=" << i + 1 << " name=" << names[i] << " strategy=" << strategies[i]
+				<< " mean=" << stats[i].mean << " stddev=" << sqrt(stats[i].variance())
+				<< " ci_low=" << stats[i].mean - half << " ci_high=" << stats[i].mean + half << '\n';
+		}
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,122 @@
+/*---------------------------------------------------*/
+/* Program: TraceQuery.cpp                           */
+/* Description: Answers queries on a binary match    */
+/* trace written with --trace: the score after a     */
+/* round, the first defection of a side and the      */
+/* cooperation rate per window of rounds.            */
+/*---------------------------------------------------*/
+
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "PrisonersDilemma.h"
+
+using namespace std;
+using namespace ipd;
+
+//Print the command-line usage of the query tool
+void printUsage(const char* program)
+{
+	cerr << "Usage: " << program << " FILE info" << endl;
+	cerr << "       " << program << " FILE score ROUNDS" << endl;
+	cerr << "       " << program << " FILE first-defection A|B" << endl;
+	cerr << "       " << program << " FILE cooperation A|B WINDOW" << endl;
+	cerr << "Rounds are counted from 0; side A is player 2 of the traced game and B is player 1." << endl;
+}
+
+//Read a side name (A or B) into 0 or 1
+bool parseSide(const string& text, int& side)
+{
+	if (text != "A" && text != "B")
+	{
+		cerr << "Error: The side must be A or B" << endl;
+		return false;
+	}
+
+	side = (text == "A") ? 0 : 1;
+	return true;
+}
+
+//Main function
+int main(int argc, char* argv[])
+{
+	if (argc < 3)
+	{
+		printUsage(argv[0]);
+		return 1;
+	}
+
+	TraceReader reader;
+	string error, query = argv[2];
+
+	if (!reader.open(argv[1], error))
+	{
+		cerr << "Error: " << error << endl;
+		return 1;
+	}
+
+	const TraceHeader& header = reader.getHeader();
+	int side = 0;
+
+	if (query == "info" && argc == 3)
+	{
+		cout << "rounds=" << header.rounds << " seed=" << header.seed << " block_rounds=" << header.blockRounds
+			<< " A=" << string(header.nameA, strnlen(header.nameA, sizeof(header.nameA)))
+			<< " B=" << string(header.nameB, strnlen(header.nameB, sizeof(header.nameB)))
+			<< " payoffs=" << header.payoff[0][0] << ',' << header.payoff[0][1] << ',' << header.payoff[0][2] << ',' << header.payoff[0][3]
+			<< '/' << header.payoff[1][0] << ',' << header.payoff[1][1] << ',' << header.payoff[1][2] << ',' << header.payoff[1][3]
+			<< " scoreA=" << reader.scoreAfter(0, reader.getNumOfRounds())
+			<< " scoreB=" << reader.scoreAfter(1, reader.getNumOfRounds()) << endl;
+	}
+	else if (query == "score" && argc == 4)
+	{
+		long long k = atoll(argv[3]);
+
+		if (k < 0 || k > reader.getNumOfRounds())
+		{
+			cerr << "Error: The trace has " << reader.getNumOfRounds() << " rounds" << endl;
+			return 1;
+		}
+
+		cout << "rounds=" << k << " scoreA=" << reader.scoreAfter(0, k) << " scoreB=" << reader.scoreAfter(1, k) << endl;
+	}
+	else if (query == "first-defection" && argc == 4)
+	{
+		if (!parseSide(argv[3], side))
+		{
+			return 1;
+		}
+
+		cout << "side=" << argv[3] << " first_defection=" << reader.firstDefection(side) << endl;
+	}
+	else if (query == "cooperation" && argc == 5)
+	{
+		long long window = atoll(argv[4]);
+
+		if (!parseSide(argv[3], side))
+		{
+			return 1;
+		}
+
+		if (window <= 0)
+		{
+			cerr << "Error: The window must be a positive number of rounds" << endl;
+			return 1;
+		}
+
+		vector<double> rates = reader.cooperationRates(side, window);
+
+		for (size_t w = 0; w < rates.size(); w++)
+		{
+			cout << "side=" << argv[3] << " first=" << (long long)w * window << " cooperation=" << rates[w] << '\n';
+		}
+	}
+	else
+	{
+		printUsage(argv[0]);
+		return 1;
+	}
+
+	return 0;
+}